@@ -1,11 +1,20 @@
 #define _GNU_SOURCE
 
+#include <errno.h>
 #include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <sys/prctl.h>
 
 #include "Attacks.h"
+#include "Burst.h"
+#include "Control.h"
+#include "Perf.h"
 #include "PolyRhythm.h"
+#include "RL_Shm.h"
+#include "Registry.h"
+#include "Shm.h"
+#include "Trigger.h"
 #include "Utils.h"
 
 /* In PolyRhythm's third phase (reinforcement learning),
@@ -16,44 +25,27 @@
  * RL to AP
  */
 
-/* For the shared memory communication channel */
-
-int shmid_action;
-int shmid_state;
-// give your shared memory an id, anything will do
-key_t key_action = 666644;  // Magic number
-key_t key_state = 666688;   // Magic number
-char *shared_memory_action_string;
-struct action *shared_memory_action;
-char *shared_memory_state;
-#define LEN_STATE_STRING 128
+/* For the shared memory communication channel, named per instance */
+
+rl_action_shm_t *shared_memory_action;
+rl_state_shm_t *shared_memory_state;
 #define LEN_PARAM_STRING \
     64  // Parameter file line should not exceed 64 characters
 
-/*
- *  Default parameter for different attack primitives
- *  The parameters are overwritten by those defined in
- *  the parameter file passed with the -P command-line argument.
- */
-static attack_channel_info_t attack_channels[] = {
-    {CLASS_CACHE, "cache", 0, cache_attack, {1, 6244, 1, 0, 0}},
-    {CLASS_TLB, "tlb", 0, tlb_attack, {500, 1, 1, 0, 0}},
-    {CLASS_FILESYSTEM, "filesystem", 0, filesys_attack, {1, 1, 1, 0, 0}},
-    {CLASS_INTERRUPT, "interrupt", 0, cache_attack, {1, 1, 1, 0, 0}},
-    {CLASS_DISK_IO, "disk_io", 0, advise_disk_io_attack, {50, 56223, 1, 0, 0}},
-    {CLASS_ROW_BUFFER, "row_buffer", 0, memory_row_buffer_attack, {1, 10, 1, 0, 0}},
-    {CLASS_NETWORK, "network", 0, stress_udp_flood, {65333, 2, 1, 0, 0}},
-    {CLASS_MEMORY, "memory", 0, memory_contention_attack, {1, 1, 1, 0, 0}},
-    {CLASS_SCHEDULER, "scheduler", 0, cache_attack, {1, 1, 1, 0, 0}},
-    {CLASS_SPAWN, "spawn", 0, spawn_attack, {1, 1, 1, 0, 0}},
-    {CLASS_PTR_CHASING, "ptr_chasing", 0, pointer_chasing, {1, 1, 1, 0, 0}},
-};
+/* Primitives the RL model selects from, in action order */
+static const attack_channel_t rl_channels[RL_NUM_CHANNELS] = {
+    CLASS_CACHE, CLASS_NETWORK, CLASS_ROW_BUFFER, CLASS_DISK_IO, CLASS_TLB};
 
-/*
- * This program terminates all attack and print out the states
- * The states will be fed back to the RL model
+/* Contention count of each channel that the model sees as 1.0 */
+static const double rl_state_scale[RL_NUM_CHANNELS] = {51313, 587, 641,
+                                                       23154, 47};
 
- */
+/* Period at which the action watcher samples the action shared memory */
+#define ACTION_WATCH_PERIOD_NS 20000
+
+/* Longest park while no channel is selected; bounds the rate of idle
+ * state samples */
+#define ACTION_IDLE_PERIOD_NS 5000000
 
 /*
  * These statistics below are feedbacks for Reinforcement learning
@@ -74,172 +66,12 @@ unsigned long int network_exe_time = 0;
 unsigned long int diskio_contention_count = 0;
 unsigned long int tlb_contention_count = 0;
 
-/* Some global variable for action */
-#define MAX_NUM_ACTIONS 5
-static int action_selected = 0;
-int action_list[MAX_NUM_ACTIONS];
-double exe_delays[MAX_NUM_ACTIONS];
-int action_index;
-long begin_time = 0;
-long end_time = 0;
-
-/* We define a global attack list here */
-static int attack_primitive_index = 0;
-// Store the address of primitive funcs
-static int (*attack_primitives_func_list[20])();
-
-// primitive name list
-char *attack_primitives_name_list[20];
-// int flag = 1;
-
-/*
- * # of thread need to be launch for each resource channel
- */
-
-int cache_num_threads = 0;
-int network_num_threads = 0;
-int row_buffer_num_threads = 0;
-int tlb_num_threads = 0;
-int spawn_num_threads = 0;
-int mem_ops_num_threads = 0;
-int advise_disk_num_threads = 0;
-
-/* Flag to trigger the primitive tasks */
-/* To stop an attack thread without killing it, we use flag to stop */
-int cache_flag = 1;
-int memory_flag = 1;
-int row_buffer_flag = 1;
-int tlb_flag = 1;
-int udp_flag = 1;
-int disk_flag = 1;
-int context_switch_flag = 1;
-int memory_ops_flag = 1;
-
 /* Flag to trigger online profiling */
 static int flag_online_profiling = 0;
 
 /* Flag to trigger writing states */
 static int flag_write_states = 0;
 
-/**
- * @brief Translate action to threads
- * --------------------
- * increment the number of threads according to the action:
- * e.g. action = 2 which is  CLASS_CACHE, we increment cache_num_threads
- * meaning that next action we launch cache attack thread.
- *
- * @return: void
- *
- */
-
-void action_to_num_threads(int action) {
-    switch (action) {
-        case CLASS_CACHE:  // == 0
-            cache_num_threads++;
-            break;
-        case CLASS_NETWORK:  // == 1
-            network_num_threads++;
-            break;
-        case CLASS_ROW_BUFFER:  // == 2
-            row_buffer_num_threads++;
-            break;
-        case CLASS_DISK_IO:  // == 3
-            advise_disk_num_threads++;
-            break;
-        case CLASS_TLB:  // == 5
-            tlb_num_threads++;
-            break;
-        default:
-            printf("No action selected \n");
-            break;
-    }
-}
-
-/**
- * @brief Write contention states into shared memory (Execution Time)
- */
-
-int write_states() {
-    int i;
-    char *num;
-    /* Construct the states information */
-    char buffer[LEN_STATE_STRING];
-    buffer[0] = '\0';
-    // buffer[1] = ':';
-    for (i = 0; i < MAX_NUM_ACTIONS; i++) {
-        if (asprintf(&num, "%.2f", exe_delays[i]) == -1) {
-            perror("asprintf error");
-        } else {
-            strcat(buffer, ",");
-            strcat(buffer, num);
-        }
-    }
-    /* Add a comma at the end for better spliting */
-    strcat(buffer, ",");
-
-    /* Write states into shared memory */
-    memcpy(shared_memory_state, buffer, strlen(buffer));
-    // printf("States in shared memory: %s \n", shared_memory_state);
-}
-
-/**
- * @brief Write contention states into shared memory (Count)
- */
-
-int write_states_count() {
-    int i;
-    char *num;
-    /* Construct the states information */
-    char buffer[LEN_STATE_STRING];
-    buffer[0] = '\0';
-    // buffer[1] = ':';
-
-    if (asprintf(&num, "%ld", cache_contention_count / 51313) == -1) {
-        printf("asprintf error\n");
-
-    } else {
-        strcat(buffer, ",");
-        strcat(buffer, num);
-    }
-
-    if (asprintf(&num, "%ld", network_contention_count / 587) == -1) {
-        printf("asprintf error\n");
-    } else {
-        strcat(buffer, ",");
-        strcat(buffer, num);
-    }
-
-    if (asprintf(&num, "%ld", row_buffer_contention_count / 641) == -1) {
-        printf("asprintf error\n");
-    } else {
-        strcat(buffer, ",");
-        strcat(buffer, num);
-    }
-
-    if (asprintf(&num, "%ld", diskio_contention_count / 23154) == -1) {
-        printf("asprintf error\n");
-    } else {
-        strcat(buffer, ",");
-        strcat(buffer, num);
-    }
-
-    if (asprintf(&num, "%ld", tlb_contention_count / 47) == -1) {
-        printf("asprintf error\n");
-    } else {
-        strcat(buffer, ",");
-        strcat(buffer, num);
-    }
-
-    /* Add a comma at the end for better spliting */
-    strcat(buffer, ",");
-
-    /* Write states into shared memory */
-    memcpy(shared_memory_state, buffer, strlen(buffer));
-    // printf("States in shared memory: %s \n", shared_memory_state);
-
-    return EXIT_SUCCESS;
-}
-
 /**
  * @brief Reset all contention states
  */
@@ -256,185 +88,81 @@ int reset_states() {
 }
 
 /**
- * @brief Get the next attack channel
- */
-int get_next_action() {
-    /* Calculate the last action elaplsed time */
-    end_time = get_current_time_us();
-    if (begin_time != 0) {
-        /* Store the delay for each action */
-        double tmp = (end_time - begin_time) / 5000.0;
-        exe_delays[(action_index + 4) % 5] = MIN(5, tmp);
-        // printf("Delay : %f \n", exe_delays[(action_index + 4) % 5]);
-        // MIN
-    }
-
-    /* If there is still action in the list */
-    if (action_index == 5) {
-        /* Read from shared memory */
-        // State should be already in 'shared_memory_action'
-
-        /* The action list is already read */
-        if (strlen(shared_memory_action_string) == 1) {
-            goto skip_read_action;
-        }
-
-        char **actions;
-        int *int_actions;
-        /* Parse action list */
-
-        do {
-            actions = str_split(shared_memory_action_string, ',');
-
-            int_actions = str_split_to_nums(shared_memory_action_string, ',');
-        } while (int_actions == NULL);
-
-        int i;
-
-        // printf("Shared action memory after : %s \n",
-        // shared_memory_action_string);
-
-        for (i = 0; i < MAX_NUM_ACTIONS; i++) {
-            action_list[i] = atoi(actions[i]);
-            printf("action [%d] = %d \n", i, int_actions[i]);
-
-            action_list[i] = int_actions[i];
-
-            free(*(actions + i));
-        }
-
-    skip_read_action:
-
-        /* Write contention states into shared memory */
-
-        if (flag_write_states) {
-            write_states();
-        }
-
-        /* Reset contention states */
-        reset_states();
-
-        /* Reset the index */
-        action_index = 0;
-    }
-
-    int next_action = action_list[action_index];
-    action_index++;
-
-    begin_time = end_time;
-    return next_action;
-}
-
-/**
- * @brief Switch to the next action
+ * @brief Publish the contention counts since the last call as the next
+ * state sample, and reset them
  */
-void *sched_next_tasks(int signal) {
-    int next_attack = 0;
-start:
-
-    next_attack = get_next_action();
-
-    /* According action, imcrement the # of attack thread,
-     * which translate to the next attack action.
-     */
-    action_to_num_threads(next_attack);
+int write_states() {
+    static uint64_t last_ns;
+    rl_state_sample_t sample;
+    perf_rates_t rates;
+    uint64_t action_ns;
+    int i;
 
-    // while (!action_selected)
-    // { // This loop waits if the
-    // 	usleep(100);
-    // }
-    // action_selected = 0;
-
-    /* schedule the next task */
-    if (cache_num_threads > 0) {
-        cache_flag = 1;
-        cache_num_threads--;
-        // printf("Entering cache attack. \n");
-        cache_attack();
-    } else if (network_num_threads > 0) {
-        udp_flag = 1;
-        network_num_threads--;
-        // printf("Entering network attack. \n");
-        stress_udp_flood();
-    } else if (row_buffer_num_threads > 0) {
-        row_buffer_flag = 1;
-        row_buffer_num_threads--;
-        // printf("Entering row buffer attack. \n");
-        memory_row_buffer_attack();
-    } else if (tlb_num_threads > 0) {
-        tlb_flag = 1;
-        tlb_num_threads--;
-        // printf("!!! entering tlb attack \n");
-        tlb_attack();
-    } else if (spawn_num_threads > 0) {
-        spawn_num_threads--;
-        spawn_attack();
-    } else if (mem_ops_num_threads > 0) {
-        memory_flag = 1;
-        mem_ops_num_threads--;
-        memory_contention_attack();
-    } else if (advise_disk_num_threads > 0) {
-        disk_flag = 1;
-        advise_disk_num_threads--;
-        advise_disk_io_attack();
-    } else {
-        printf("Idle because no threads to launch. \n");
+    memset(&sample, 0, sizeof(sample));
+    sample.time_ns = get_current_time_ns();
+    sample.interval_ns = last_ns ? sample.time_ns - last_ns : 0;
+    last_ns = sample.time_ns;
+    rl_action_read(shared_memory_action, &sample.action_mask,
+                   &sample.action_epoch, &action_ns);
+
+    /* In rl_channels[] order */
+    sample.count[0] = cache_contention_count;
+    sample.count[1] = network_contention_count;
+    sample.count[2] = row_buffer_contention_count;
+    sample.count[3] = diskio_contention_count;
+    sample.count[4] = tlb_contention_count;
+    for (i = 0; i < RL_NUM_CHANNELS; i++)
+        sample.state[i] = sample.count[i] / rl_state_scale[i];
+
+    if (perf_enabled() && perf_latest(&rates)) {
+        sample.perf_available = rates.available;
+        memcpy(sample.perf_rate, rates.rate, sizeof(sample.perf_rate));
     }
 
-    goto start;
+    rl_state_publish(shared_memory_state, &sample);
+    reset_states();
+    return EXIT_SUCCESS;
 }
 
 /**
- * @brief Initialize states
+ * @brief Attach a segment of the protocol in include/RL_Shm.h
  */
+static void *attach_segment(const char *segment, size_t size) {
+    void *addr = shm_map(shm_instance(), segment, size, 1);
 
-int int_states() {
-    int i;
-    for (i = 0; i < MAX_NUM_ACTIONS; i++) {
-        exe_delays[i] = 1.0;
+    if (addr == NULL) {
+        printf("(%s) Error attaching shared memory of instance %s: %s\n",
+               segment, shm_instance(), strerror(errno));
     }
-    return EXIT_SUCCESS;
+    return addr;
 }
 
 /**
  * @brief Initialize shared memory
  */
 int init_shared_memory() {
-    /* Initial states which are inputs for RL */
-    int_states();
-
-    // Setup shared memory, 32 is the size
-    if ((shmid_state = shmget(KEY_STATE, 32, IPC_CREAT | 0666)) < 0) {
-        printf("State SHMemory: Error getting shared memory id\n");
-        return EXIT_FAILURE;
-    }
-    // Attached shared memory
-    if ((shared_memory_state = shmat(shmid_state, NULL, 0)) == (char *)-1) {
-        printf("(State) Error attaching shared memory id\n");
-        return EXIT_FAILURE;
-    }
-    write_states();
-    printf("Initialized states \n");
+    shared_memory_state = attach_segment(SHM_STATE, sizeof(rl_state_shm_t));
+    if (shared_memory_state == NULL) return EXIT_FAILURE;
+    rl_state_init(shared_memory_state);
+    printf("Initialized states of instance %s \n", shm_instance());
 
     /* Again, for action shared memory */
-    if ((shmid_action = shmget(KEY_ACTION, 20, IPC_CREAT | 0666)) < 0) {
-        printf("Action SHMemory: Error getting shared memory id\n");
-        return EXIT_FAILURE;
-    }
-    if ((shared_memory_action = (struct action *)shmat(
-             shmid_action, NULL, 0)) == (struct action *)-1) {
-        printf("(Action) Error attaching shared memory id\n");
+    shared_memory_action = attach_segment(SHM_ACTION,
+                                          sizeof(rl_action_shm_t));
+    if (shared_memory_action == NULL) return EXIT_FAILURE;
+    if (shared_memory_action->magic != 0 &&
+        !rl_shm_compatible(shared_memory_action->magic,
+                           shared_memory_action->version)) {
+        printf("Action SHMemory: version %u, expected %u (remove "
+               "/dev/shm/polyrhythm.%s.%s)\n",
+               shared_memory_action->version, RL_SHM_VERSION,
+               shm_instance(), SHM_ACTION);
         return EXIT_FAILURE;
     }
 
-    /* Write an initial action into the shared memory */
-    struct action init_action;
-    init_action.cache = 1;
-    init_action.network = 0;
-    init_action.row_buffer = 0;
-    init_action.disk = 0;
-    init_action.tlb = 0;
-    memcpy(shared_memory_action, &init_action, sizeof(struct action));
+    /* Write an initial action into the shared memory: cache */
+    rl_action_init(shared_memory_action);
+    rl_action_write(shared_memory_action, 1U << 0, get_current_time_ns());
 
     return EXIT_SUCCESS;
 }
@@ -443,53 +171,21 @@ int init_shared_memory() {
  * @brief Initialize attack channels
  */
 int init_all_attack_channels() {
-    int i = 0;
+    unsigned int i;
 
-    attack_channel_info_t *iter = &attack_channels[0];
-
-    while (iter->name != NULL) {
-        i++;
-
-        /* Store the number of threads to launch */
-        if (strcmp(iter->name, "cache") == 0) {
-            cache_num_threads = iter->num_threads;
+    /* -o runs the online contention region search of every primitive */
+    for (i = 0; i < (unsigned int)num_primitives(); i++) {
+        if (flag_online_profiling)
+            primitive_at(i)->params[NUM_PARAMS] = 1;
+    }
 
-            if (flag_online_profiling) {
-                init_online_profiling_cache_attack(&iter->attack_paras);
-            } else {
-                init_cache_attack(&iter->attack_paras);
-            }
-        } else if (strcmp(iter->name, "network") == 0) {
-            init_udp_attack(&iter->attack_paras);
-            network_num_threads = iter->num_threads;
-            // printf("network attacks\n");
-        } else if (strcmp(iter->name, "row_buffer") == 0) {
-            init_memory_row_buffer_attack(&iter->attack_paras);
-            row_buffer_num_threads = iter->num_threads;
-            // printf("init row buffer attacks\n");
-        } else if (strcmp(iter->name, "tlb") == 0) {
-            init_tlb_attack(&iter->attack_paras);
-            tlb_num_threads = iter->num_threads;
-        } else if (strcmp(iter->name, "spawn") == 0) {
-            spawn_num_threads = iter->num_threads;
-        } else if (strcmp(iter->name, "memory") == 0) {
-            init_memory_contention_attack(&iter->attack_paras);
-            mem_ops_num_threads = iter->num_threads;
-        } else if (strcmp(iter->name, "disk_io") == 0) {
-            init_advise_disk_io_attack(&iter->attack_paras);
-            advise_disk_num_threads = iter->num_threads;
-        }
+    /* Threads are launched by actions, not from the command line */
+    for (i = 0; i < RL_NUM_CHANNELS; i++) {
+        primitive_ctx_t *ctx = get_primitive(rl_channels[i]);
 
-        // Attack channels are all set
-        if (i > NUM_CHANNELS) {
-            break;
+        if (ctx == NULL || init_primitive(ctx) != EXIT_SUCCESS) {
+            return EXIT_FAILURE;
         }
-        /* push the funcs into waitlists */
-
-        attack_primitives_name_list[attack_primitive_index] = iter->name;
-        attack_primitives_func_list[attack_primitive_index++] =
-            iter->attack_func;
-        iter = &attack_channels[i];
     }
 
     return EXIT_SUCCESS;
@@ -499,16 +195,12 @@ int init_all_attack_channels() {
  * @brief Print attack channel info for debugging
  */
 void print_channels() {
-    // Number of attack channels
-    const int num_attack_channels =
-        sizeof(attack_channels) / sizeof(attack_channel_info_t);
-
-    for (int i = 0; i < num_attack_channels; i++) {
-        attack_channel_info_t *a = &attack_channels[i];
-        printf("%d (%s) -- num_threads: %d -- params:", a->attack_channel,
-               a->name, a->num_threads);
+    for (int i = 0; i < num_primitives(); i++) {
+        primitive_ctx_t *a = primitive_at(i);
+        printf("%d (%s) -- num_threads: %d -- params:", a->desc.id,
+               a->desc.name, a->num_threads);
         for (int j = 0; j < NUM_PARAMS + 1; j++) {
-            printf(" %d", a->attack_paras[j]);
+            printf(" %d", a->params[j]);
         }
         printf("\n");
     }
@@ -521,10 +213,6 @@ int read_channel_params(FILE *params) {
     // For debugging:
     // print_channels();
 
-    // Number of attack channels
-    const int num_attack_channels =
-        sizeof(attack_channels) / sizeof(attack_channel_info_t);
-
     // For parsing parameter file lines
     char line[LEN_PARAM_STRING];
     char *token;
@@ -533,8 +221,6 @@ int read_channel_params(FILE *params) {
 
     // Read line-by-line from parameter file
     while (fgets(line, LEN_PARAM_STRING, params)) {
-        int i;
-
         if (null_token) break;
 
         token = strtok(line, sep);
@@ -542,26 +228,22 @@ int read_channel_params(FILE *params) {
         // First token is the channel
 
         // Search for the channel
-        for (i = 0; i < num_attack_channels; i++) {
-            if (!strcmp(attack_channels[i].name, token)) break;
-        }
+        primitive_ctx_t *a = find_primitive(token);
 
         // Channel not found
-        if (i == num_attack_channels) {
+        if (a == NULL) {
             printf("Channel %s invalid!\n", token);
             return EXIT_FAILURE;
         }
 
         // Assign subsequent parameter values
-        attack_channel_info_t *a = &attack_channels[i];
-
         for (int j = 0; j < NUM_PARAMS + 1; j++) {
             token = strtok(NULL, sep);
             if (!token) {
                 null_token = 1;
                 break;
             }
-            a->attack_paras[j] = atoi(token);
+            a->params[j] = atoi(token);
         }
     }
 
@@ -576,24 +258,103 @@ int read_channel_params(FILE *params) {
     return EXIT_SUCCESS;
 }
 
+/**
+ * @brief Whether the action in shared memory selects a channel
+ */
+static int action_enabled(attack_channel_t channel) {
+    uint32_t mask = __atomic_load_n(&shared_memory_action->mask,
+                                    __ATOMIC_ACQUIRE);
+    int i;
+
+    for (i = 0; i < RL_NUM_CHANNELS; i++) {
+        if (rl_channels[i] == channel) return (mask >> i) & 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Action watcher
+ * --------------------
+ * Samples the action written by the RL model and posts CTL_SWITCH to the
+ * attack thread when its channel is deselected. The attack loops only
+ * look at their own control block, so the switch latency is one watcher
+ * period plus one work quantum of the primitive. While no thread is busy
+ * there is nothing to switch until the next action, so it parks on it.
+ */
+static void *watch_actions(void *arg) {
+    struct timespec period = {.tv_sec = 0, .tv_nsec = ACTION_WATCH_PERIOD_NS};
+    int i;
+
+    /* Default slack would stretch the period to 50us or more */
+    (void)prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+
+    while (!ctl_stopping()) {
+        uint32_t seq = __atomic_load_n(&shared_memory_action->seq,
+                                       __ATOMIC_ACQUIRE);
+        int busy = 0;
+
+        for (i = 0; i < ctl_count(); i++) {
+            attack_ctl_t *ctl = ctl_at(i);
+
+            if (!ctl_busy(ctl)) continue;
+            busy = 1;
+            if (!action_enabled(ctl->channel)) ctl_post(ctl, CTL_SWITCH);
+        }
+
+        if (busy)
+            nanosleep(&period, NULL);
+        else
+            rl_action_wait(shared_memory_action, seq, ACTION_IDLE_PERIOD_NS);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief SIGINT/SIGTERM: stop the attack loop, a second signal kills
+ */
+void disable_all_flags_rl(int signal) { stop_all_primitives(); }
+
 /**
  * @brief Switch to the next action
  */
 void main_attack_loop() {
-    while (1) {
-        cache_attack();
-        stress_udp_flood();
-        memory_row_buffer_attack();
-        advise_disk_io_attack();
-        tlb_attack();
-        advise_disk_io_attack();
+    static const attack_channel_t loop[] = {
+        CLASS_CACHE, CLASS_NETWORK, CLASS_ROW_BUFFER,
+        CLASS_DISK_IO, CLASS_TLB, CLASS_DISK_IO};
+    unsigned int i;
+    pthread_t watcher;
+
+    if (pthread_create(&watcher, NULL, watch_actions, NULL) != 0) {
+        printf("Cannot start the action watcher \n");
+        return;
+    }
 
-        /* Write the states in to shared memory */
-        if (flag_write_states) {
-            write_states_count();
-            reset_states();
+    while (!ctl_stopping()) {
+        uint32_t seq = __atomic_load_n(&shared_memory_action->seq,
+                                       __ATOMIC_ACQUIRE);
+        int ran = 0;
+
+        for (i = 0; i < sizeof(loop) / sizeof(loop[0]); i++) {
+            primitive_ctx_t *ctx = get_primitive(loop[i]);
+
+            /* Runs until the watcher switches it away */
+            if (action_enabled(loop[i])) {
+                run_primitive(ctx);
+                ran = 1;
+            }
         }
+
+        /* Nothing selected: park until the next action instead of
+         * spinning through the loop */
+        if (!ran)
+            rl_action_wait(shared_memory_action, seq, ACTION_IDLE_PERIOD_NS);
+
+        /* Write the states in to shared memory */
+        if (flag_write_states) write_states();
     }
+
+    pthread_join(watcher, NULL);
 }
 
 int main(int argc, char *argv[]) {
@@ -617,7 +378,7 @@ int main(int argc, char *argv[]) {
     int opt;
     FILE *params = NULL;
 
-    while ((opt = getopt(argc, argv, "owP:")) != -1) {
+    while ((opt = getopt(argc, argv, "owP:b:t:m:i:")) != -1) {
         switch (opt) {
             case 'o':
                 flag_online_profiling = 1;
@@ -633,14 +394,38 @@ int main(int argc, char *argv[]) {
                     return EXIT_FAILURE;
                 }
                 break;
+            case 'b':
+                if (burst_parse(optarg) != EXIT_SUCCESS) return EXIT_FAILURE;
+                break;
+            case 't':
+                if (trigger_parse(optarg) != EXIT_SUCCESS) return EXIT_FAILURE;
+                break;
+            case 'm':
+                if (perf_parse(optarg) != EXIT_SUCCESS) return EXIT_FAILURE;
+                break;
+            case 'i':
+                if (shm_set_instance(optarg) != EXIT_SUCCESS)
+                    return EXIT_FAILURE;
+                break;
             default: /* '?' */
-                fprintf(stderr, "Usage: %s -P file/path [-o] [-w]\n", argv[0]);
+                fprintf(stderr,
+                        "Usage: %s -P file/path [-o] [-w] "
+                        "[-b on_us,period_us[,phase_us[,jitter_us]]] "
+                        "[-t shm:key|futex:key|pipe:path|proc:pid] "
+                        "[-m all|pid:pid|self[,period_us]] [-i instance]\n",
+                        argv[0]);
                 exit(EXIT_FAILURE);
         }
     }
+    if (burst_check_trigger() != EXIT_SUCCESS) return EXIT_FAILURE;
     // print_options(attack_channels);
     /*********** End of Parse arguments ***********/
 
+    /*********** Register attack primitives ***********/
+    register_builtin_primitives();
+    ret = load_primitive_plugins();
+    if (ret != EXIT_SUCCESS) exit(ret);
+
     /*********** Read attack channel parameters ***********/
     ret = read_channel_params(params);
     if (ret != EXIT_SUCCESS) exit(ret);
@@ -649,6 +434,12 @@ int main(int argc, char *argv[]) {
     ret = init_shared_memory();
     if (ret != EXIT_SUCCESS) exit(ret);
 
+    /*********** Start the hardware counters ***********/
+    if (perf_enabled()) {
+        ret = perf_start();
+        if (ret != EXIT_SUCCESS) exit(ret);
+    }
+
     /*********** Initialize attack channels ***********/
     ret = init_all_attack_channels();
     if (ret != EXIT_SUCCESS) exit(ret);
@@ -659,8 +450,20 @@ int main(int argc, char *argv[]) {
     // int dummy_signal;
     // sched_next_tasks(dummy_signal); // Here we need a signal for some
     // historical reasons
+    struct sigaction sa;
+
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = disable_all_flags_rl;
+    sa.sa_flags = SA_RESETHAND;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
     main_attack_loop();
 
+    print_primitive_stats();
+    ctl_print_latency();
+    perf_print();
     return EXIT_SUCCESS;
 }
 
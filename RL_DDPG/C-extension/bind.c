@@ -1,14 +1,31 @@
 #include "libshm.h"
 
-char init_shmfunc_docs[] = "Initialize the shared memory";
-char write_shmfunc_docs[] = "Write the data into shared memory";
+char init_shmfunc_docs[] = "Attach the action shared memory of an instance";
+char init_statefunc_docs[] =
+    "Attach the state shared memory of an instance, OSError until rl "
+    "created it";
+char write_shmfunc_docs[] = "Write the action into shared memory";
+char read_statefunc_docs[] =
+    "Newest state sample (seq, time_ns, state, count, perf), or None";
+char read_statesfunc_docs[] =
+    "State samples after seq still in the ring, oldest first";
+
+/* The instance argument is optional everywhere, it defaults to
+ * $POLYRHYTHM_INSTANCE or "0" like for rl */
 
 PyMethodDef shmextension_funcs[] = {
-    {"init_shm", (PyCFunction)init_shm, METH_NOARGS, init_shmfunc_docs},
+    {"init_shm", (PyCFunction)init_shm, METH_VARARGS, init_shmfunc_docs},
+    {"init_state", (PyCFunction)init_state, METH_VARARGS,
+     init_statefunc_docs},
     {"write_shm", (PyCFunction)write_shm, METH_VARARGS, write_shmfunc_docs},
+    {"read_state", (PyCFunction)read_state, METH_VARARGS,
+     read_statefunc_docs},
+    {"read_states", (PyCFunction)read_states, METH_VARARGS,
+     read_statesfunc_docs},
     {NULL}};
 
-char shmextensionmod_docs[] = "This is a C extension for writing action.";
+char shmextensionmod_docs[] =
+    "This is a C extension for writing actions and reading states.";
 
 PyModuleDef shmextension_mod = {PyModuleDef_HEAD_INIT,
                                 "shmextension",
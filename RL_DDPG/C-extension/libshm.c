@@ -1,68 +1,243 @@
 #include "libshm.h"
 
 #include <Python.h>
+#include <sys/mman.h>
+#include <time.h>
 
-/* For the shared memory communication channel */
-#include <sys/ipc.h>
-#include <sys/shm.h>
-#include <sys/types.h>
+/* For the shared memory communication channel, named per instance */
+#include "Shm.h"
 
-#define KEY_ACTION 666644
-struct action *shared_memory_action;
+/* Segments of every instance attached so far */
+#define MAX_INSTANCES 64
 
-PyObject *init_shm(PyObject *self) {
-    /* Shared memory */
-    int shmid_action;
-    if ((shmid_action = shmget(KEY_ACTION, 20, IPC_CREAT | 0666)) < 0) {
-        printf("Action SHMemory: Error getting shared memory id\n");
-        return PyUnicode_FromFormat("Error");  // TODO return value
+static struct instance {
+    char name[SHM_INSTANCE_MAX + 1];
+    rl_action_shm_t *action;
+    rl_state_shm_t *state;
+} instances[MAX_INSTANCES];
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * @brief The entry of an instance, added if new; the default instance
+ * comes from POLYRHYTHM_INSTANCE, as for rl
+ */
+static struct instance *find_instance(const char *name) {
+    int i;
+
+    if (name == NULL) name = shm_instance();
+    for (i = 0; i < MAX_INSTANCES && instances[i].name[0]; i++) {
+        if (strcmp(instances[i].name, name) == 0) return &instances[i];
+    }
+    if (i == MAX_INSTANCES) {
+        PyErr_SetString(PyExc_RuntimeError, "Too many instances");
+        return NULL;
+    }
+    if (strlen(name) > SHM_INSTANCE_MAX) {
+        PyErr_Format(PyExc_ValueError, "Invalid instance name %s", name);
+        return NULL;
+    }
+    strcpy(instances[i].name, name);
+    return &instances[i];
+}
+
+PyObject *init_shm(PyObject *self, PyObject *args) {
+    const char *name = NULL;
+    struct instance *inst;
+    rl_action_shm_t *action;
+
+    if (!PyArg_ParseTuple(args, "|s", &name)) {
+        return NULL;
     }
+    if ((inst = find_instance(name)) == NULL) return NULL;
+    if (inst->action != NULL) Py_RETURN_NONE;
 
-    if ((shared_memory_action = (struct action *)shmat(
-             shmid_action, NULL, 0)) == (struct action *)-1) {
-        printf("(Action) Error attaching shared memory id\n");
-        return PyUnicode_FromFormat("Error");
-        ;
+    /* Shared memory, created by rl or by us first */
+    action = shm_map(inst->name, SHM_ACTION, sizeof(rl_action_shm_t), 1);
+    if (action == NULL) {
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+
+    if (action->magic == 0) {
+        rl_action_init(action);
+    } else if (!rl_shm_compatible(action->magic, action->version)) {
+        PyErr_Format(PyExc_RuntimeError,
+                     "Action shared memory of instance %s has version %u, "
+                     "expected %u",
+                     inst->name, action->version, RL_SHM_VERSION);
+        munmap(action, sizeof(*action));
+        return NULL;
+    }
+
+    inst->action = action;
+    Py_RETURN_NONE;
+}
+
+PyObject *init_state(PyObject *self, PyObject *args) {
+    const char *name = NULL;
+    struct instance *inst;
+    rl_state_shm_t *state;
+
+    if (!PyArg_ParseTuple(args, "|s", &name)) {
+        return NULL;
+    }
+    if ((inst = find_instance(name)) == NULL) return NULL;
+    if (inst->state != NULL) Py_RETURN_NONE;
+
+    /* Created by rl, fails until it runs */
+    state = shm_map(inst->name, SHM_STATE, sizeof(rl_state_shm_t), 0);
+    if (state == NULL) {
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+
+    if (!rl_shm_compatible(__atomic_load_n(&state->magic, __ATOMIC_ACQUIRE),
+                           state->version)) {
+        PyErr_Format(PyExc_RuntimeError,
+                     "State shared memory of instance %s has version %u, "
+                     "expected %u",
+                     inst->name, state->version, RL_SHM_VERSION);
+        munmap(state, sizeof(*state));
+        return NULL;
     }
 
-    return PyUnicode_FromFormat("Hello C extension!");
+    inst->state = state;
+    Py_RETURN_NONE;
 }
 
 PyObject *write_shm(PyObject *self, PyObject *args) {
     int num;
     char *name;
+    const char *instance = NULL;
+    struct instance *inst;
 
-    /* Initialize the action */
-    struct action tmp_action;
-    tmp_action.cache = 0;
-    tmp_action.row_buffer = 0;
-    tmp_action.network = 0;
-    tmp_action.disk = 0;
-    tmp_action.tlb = 0;
+    if (!PyArg_ParseTuple(args, "is|s", &num, &name, &instance)) {
+        return NULL;
+    }
+    if ((inst = find_instance(instance)) == NULL) return NULL;
+    if (inst->action == NULL) {
+        PyErr_Format(PyExc_RuntimeError, "init_shm(\"%s\") was not called",
+                     inst->name);
+        return NULL;
+    }
+
+    /* One channel per action, in rl_channels[] order; others: none */
+    rl_action_write(inst->action,
+                    num >= 0 && num < RL_NUM_CHANNELS ? 1U << num : 0,
+                    monotonic_ns());
+
+    Py_RETURN_NONE;
+}
+
+/**
+ * @brief The state segment of an instance, NULL with an exception if it
+ * was not attached
+ */
+static rl_state_shm_t *attached_state(const char *instance) {
+    struct instance *inst = find_instance(instance);
+
+    if (inst != NULL && inst->state == NULL) {
+        PyErr_Format(PyExc_RuntimeError, "init_state(\"%s\") was not called",
+                     inst->name);
+    }
+    return inst != NULL ? inst->state : NULL;
+}
+
+/**
+ * @brief A state sample as (seq, time_ns, [state], [count], {perf rates})
+ */
+static PyObject *sample_to_tuple(const rl_state_sample_t *sample) {
+    static const char *perf_names[PERF_NUM_COUNTERS] = {
+        "cycles", "LLC-misses", "dTLB-misses", "bus-cycles",
+        "context-switches"};
+    PyObject *state = PyList_New(RL_NUM_CHANNELS);
+    PyObject *count = PyList_New(RL_NUM_CHANNELS);
+    PyObject *perf = PyDict_New();
+    int i;
+
+    if (!state || !count || !perf) goto error;
+    for (i = 0; i < RL_NUM_CHANNELS; i++) {
+        PyList_SET_ITEM(state, i, PyFloat_FromDouble(sample->state[i]));
+        PyList_SET_ITEM(count, i,
+                        PyLong_FromUnsignedLongLong(sample->count[i]));
+    }
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        PyObject *rate;
 
-    if (!PyArg_ParseTuple(args, "is", &num, &name)) {
+        if (!(sample->perf_available & (1U << i))) continue;
+        rate = PyFloat_FromDouble(sample->perf_rate[i]);
+        if (!rate || PyDict_SetItemString(perf, perf_names[i], rate) < 0) {
+            Py_XDECREF(rate);
+            goto error;
+        }
+        Py_DECREF(rate);
+    }
+
+    return Py_BuildValue("(KKNNN)", (unsigned long long)sample->seq,
+                         (unsigned long long)sample->time_ns, state, count,
+                         perf);
+
+error:
+    Py_XDECREF(state);
+    Py_XDECREF(count);
+    Py_XDECREF(perf);
+    return NULL;
+}
+
+PyObject *read_state(PyObject *self, PyObject *args) {
+    const char *instance = NULL;
+    rl_state_shm_t *state;
+    rl_state_sample_t sample;
+
+    if (!PyArg_ParseTuple(args, "|s", &instance)) {
         return NULL;
     }
+    if ((state = attached_state(instance)) == NULL) return NULL;
+
+    /* The newest sample; retry if rl laps the ring meanwhile */
+    for (;;) {
+        uint64_t head = __atomic_load_n(&state->head, __ATOMIC_ACQUIRE);
+
+        if (head == 0) Py_RETURN_NONE;
+        if (rl_state_read(state, head, &sample))
+            return sample_to_tuple(&sample);
+    }
+}
+
+PyObject *read_states(PyObject *self, PyObject *args) {
+    unsigned long long after, seq, head;
+    const char *instance = NULL;
+    rl_state_shm_t *state;
+    rl_state_sample_t sample;
+    PyObject *list;
 
-    switch (num) {
-        case 0:
-            tmp_action.cache = 1;
-            break;
-        case 1:
-            tmp_action.network = 1;
-            break;
-        case 2:
-            tmp_action.row_buffer = 1;
-            break;
-        case 3:
-            tmp_action.disk = 1;
-            break;
-        case 4:
-            tmp_action.tlb = 1;
-            break;
+    if (!PyArg_ParseTuple(args, "K|s", &after, &instance)) {
+        return NULL;
     }
+    if ((state = attached_state(instance)) == NULL) return NULL;
+
+    /* The samples after seq still in the ring, oldest first */
+    head = __atomic_load_n(&state->head, __ATOMIC_ACQUIRE);
+    seq = head > RL_STATE_RING && after < head - RL_STATE_RING
+              ? head - RL_STATE_RING
+              : after;
+    if ((list = PyList_New(0)) == NULL) return NULL;
+    for (seq++; seq <= head; seq++) {
+        PyObject *item;
 
-    memcpy(shared_memory_action, &tmp_action, sizeof(struct action));
+        if (!rl_state_read(state, seq, &sample)) continue;
+        if ((item = sample_to_tuple(&sample)) == NULL ||
+            PyList_Append(list, item) < 0) {
+            Py_XDECREF(item);
+            Py_DECREF(list);
+            return NULL;
+        }
+        Py_DECREF(item);
+    }
 
-    return PyUnicode_FromFormat("Hay %s!  You gave me %d.", name, num);
+    return list;
 }
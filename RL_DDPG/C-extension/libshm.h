@@ -3,16 +3,13 @@
 
 #include <Python.h>
 
-/* Attack action buffer */
-struct action {
-    int cache;
-    int network;
-    int row_buffer;
-    int disk;
-    int tlb;
-};
+/* Shared memory layout, shared with rl */
+#include "RL_Shm.h"
 
-PyObject *init_shm(PyObject *);
+PyObject *init_shm(PyObject *, PyObject *);
+PyObject *init_state(PyObject *, PyObject *);
 PyObject *write_shm(PyObject *, PyObject *);
+PyObject *read_state(PyObject *, PyObject *);
+PyObject *read_states(PyObject *, PyObject *);
 
 #endif
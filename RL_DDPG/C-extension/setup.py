@@ -5,5 +5,7 @@ from distutils.core import setup, Extension
 setup(
 	name = "shmextension",
 	version = "1.0",
-	ext_modules = [Extension("shmextension", ["bind.c", "libshm.c"])]
+	ext_modules = [Extension("shmextension",
+		["bind.c", "libshm.c", "../../src/Shm.c"],
+		include_dirs = ["../../include"], libraries = ["rt"])]
 	);
@@ -2,6 +2,8 @@
 
 import shmextension
 
-print(shmextension.hello());
-print(shmextension.write_shm(5, "StarNight"));
+shmextension.init_shm()
+shmextension.write_shm(0, "StarNight")
+shmextension.init_state()
+print(shmextension.read_state())
 #help(shmextension);
@@ -3,7 +3,6 @@ sys.path.append('../GA/')
 
 from launch import *
 # from paramiko import SSHClient
-import sysv_ipc
 from time import sleep
 import subprocess
 
@@ -70,18 +69,20 @@ def wait_for_action(conn):
 if __name__ == "__main__":
 
     poly_rhythm_path = '../build/rl'
+    # One shared memory instance per attack process; the first one
+    # reports the states
+    instances = ['core0', 'core1', 'core2', 'core3']
     # subprocess.Popen([poly_rhythm_path,"cache","1", "1", "16384", "0", "0"])
-    subprocess.Popen([poly_rhythm_path, '-w', '-P', '../params.txt'])
-    subprocess.Popen([poly_rhythm_path, '-P', '../params.txt'])
-    subprocess.Popen([poly_rhythm_path, '-P', '../params.txt'])
-    subprocess.Popen([poly_rhythm_path, '-P', '../params.txt'])
+    subprocess.Popen([poly_rhythm_path, '-i', instances[0], '-w', '-P', '../params.txt'])
+    for instance in instances[1:]:
+        subprocess.Popen([poly_rhythm_path, '-i', instance, '-P', '../params.txt'])
 
     while True:
         try:
-            # Register a shared memory to communication with attack process
-            state_memory = sysv_ipc.SharedMemory(666688) 
+            # Attach the state shared memory, created by the attack process
+            shmextension.init_state(instances[0])
 
-        except:
+        except OSError:
             continue
         else:
             # Register a shared memory to communication with attack process
@@ -95,10 +96,12 @@ if __name__ == "__main__":
             break
 
     ### Init action shared memory
-    shmextension.init_shm()
+    for instance in instances:
+        shmextension.init_shm(instance)
 
     # Initialize an arbitrary action list 
-    shmextension.write_shm(0, "action")
+    for instance in instances:
+        shmextension.write_shm(0, "action", instance)
 
     # Connection to training platform
     conn = init_connection()
@@ -120,12 +123,17 @@ if __name__ == "__main__":
         
         # Write value to action memory
         action = action_list[current_action_index]
-        shmextension.write_shm(int(action), "Action")
+        for instance in instances:
+            shmextension.write_shm(int(action), "Action", instance)
 
         # If need read new action lists
         if current_action_index == 4:
-            # Read value from shared memory
-            state_value = state_memory.read()
+            # Read the newest state sample from shared memory, and send
+            # it in the ",s1,s2,s3,s4,s5," format of the training platform
+            sample = shmextension.read_state(instances[0])
+            states = sample[2] if sample is not None else [0.0] * 5
+            state_value = bytes("," + ",".join("%.2f" % s for s in states) + ",",
+                                encoding = 'utf-8')
 
             # Send states to RL model under training
             ###############################################
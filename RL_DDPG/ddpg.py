@@ -265,7 +265,7 @@ class DDPG:
                 lastState = Variable(obs2state([last_state_1,last_state_2,last_state_3,last_state_4,last_state_5]), volatile=True) 
 
             ### Read states from shared memory           
-            responses = self.env.state_memory.read().decode("utf-8")
+            responses = self.env.read_states()
             state, reward = self.env.update_state(responses)
 
             ### Save the state into
@@ -3,7 +3,6 @@
 #from GA.launch import *
 from paramiko import SSHClient
 import connections
-import sysv_ipc
 import time
 
 import sys
@@ -15,7 +14,7 @@ NUM_RESOURCES = 5
 
 class Environment():
     """Environment initialization function"""
-    def __init__(self, target_ip = '127.0.0.1', is_attack = False):
+    def __init__(self, target_ip = '127.0.0.1', is_attack = False, instance = None):
         #anything needs to be initilized
         print("Initialization!")
         self.action_dic = {
@@ -51,13 +50,14 @@ class Environment():
         self.target_ip = target_ip
 
         self.is_attack = is_attack
+
+        # Shared memory instance of the attack process (rl -i), None for
+        # $POLYRHYTHM_INSTANCE or "0"
+        self.instance = instance
         ### Attack environment
         if self.is_attack:
             # Register a shared memory to communication with attack process
-            self.action_memory = sysv_ipc.SharedMemory(666644)
-
-            # Register a shared memory to communication with attack process
-            self.state_memory = sysv_ipc.SharedMemory(666688) 
+            shmextension.init_state(*self.instance_args())
         ### Traning environment
         else:
             self.socket, ret  = connections.init_connection(self.target_ip)
@@ -67,14 +67,18 @@ class Environment():
                 exit(-1)
         
         ### Init the shared memory 
-        shmextension.init_shm()
+        shmextension.init_shm(*self.instance_args())
 
         ### Action index
         self.current_action_index = 0
 
     
-    def update_state(self, responses):
-        """Update current state from environment"""
+    def instance_args(self):
+        return () if self.instance is None else (self.instance,)
+
+    def update_state(self, states):
+        """Update current state from environment, states[i] is the
+        normalized contention of action i"""
         reward = 0
 
         # print("Update state: ", responses)    
@@ -107,16 +111,15 @@ class Environment():
         count = count + 1 
         '''
 
-        # print("states : ", responses)     
-        states = responses.split(",")
+        # print("states : ", states)
 
-        self.state['d_action_1'] = float(states[1])
-        self.state['d_action_2'] = float(states[2])
-        self.state['d_action_3'] = float(states[3])
-        self.state['d_action_4'] = float(states[4])
-        self.state['d_action_5'] = float(states[5])
+        self.state['d_action_1'] = states[0]
+        self.state['d_action_2'] = states[1]
+        self.state['d_action_3'] = states[2]
+        self.state['d_action_4'] = states[3]
+        self.state['d_action_5'] = states[4]
 
-        reward = float(states[1]) + float(states[2]) + float(states[3]) + float(states[4]) + float(states[5])
+        reward = sum(states[:5])
         
         return self.state, reward
 
@@ -154,10 +157,10 @@ class Environment():
         ### Send the action list
         connections.send_action(self.socket, action_list)
 
-        ### Wait for feedback states
+        ### Wait for feedback states, ",s1,s2,s3,s4,s5,"
         responses = connections.wait_for_state(self.socket)
 
-        return (True, responses)
+        return (True, [float(s) for s in responses.split(",")[1:6]])
 
     def perform_action_attacking(self, action):
         '''Send actions to local polyrhythm threads
@@ -165,9 +168,8 @@ class Environment():
         '''
 
         ### Write the action list into shared memory
-        # self.action_memory.write(action_list)
 
-        shmextension.write_shm(int(action), "StarNight")
+        shmextension.write_shm(int(action), "StarNight", *self.instance_args())
 
         # Increment to the next action
         self.current_action_index += 1
@@ -175,10 +177,18 @@ class Environment():
         # Sleep for 5 ms, this is the duration for an action list
         time.sleep(5/1000)
         
-        # Read value from shared memory
-        responses = self.state_memory.read().decode("utf-8")
+        return (True, self.read_states())
+
+    def read_states(self):
+        '''Newest normalized states from the attack process, the
+        current ones if it has not published a sample yet.
+        '''
+        sample = shmextension.read_state(*self.instance_args())
+        if sample is None:
+            return list(self.state.values())
 
-        return (True, responses)
+        seq, time_ns, states, counts, perf_rates = sample
+        return states
 
 
     def new_reset(self):
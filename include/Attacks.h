@@ -6,6 +6,7 @@
  *  Parameters for cache
  */
 #define KB ((1) << 10)
+#define MB ((KB) << 10)
 #define CACHE_LINE 64
 #define LLC_CACHE_SIZE 512 * KB  // 512 for pi3, 6144 for AMD
 
@@ -16,15 +17,6 @@
 #define PAGE_SIZE (4 * KB)
 #define MMAP_PAGES (512)
 
-/* Attack action buffer */
-struct action {
-    int cache;
-    int network;
-    int row_buffer;
-    int disk;
-    int tlb;
-};
-
 /* Architecture-level contention channels */
 
 /* Cache attack */
@@ -113,6 +105,13 @@ int online_profiling_udp_remap_domain(
 
 int online_profiling_stress_udp_flood();
 
+/* TCP loopback stream / connection churn attack */
+int init_tcp_attack(void *arguments);
+
+int tcp_attack();
+
+void tcp_attack_stats(double secs);
+
 /* Memory bus attack */
 
 int init_memory_contention_attack(void *arguments);
@@ -129,21 +128,116 @@ int init_filesys_attack(void *arguments);
 
 int filesys_attack();
 
-/* Thread spawning attack */
+void filesys_attack_stats(double secs);
+
+/* File system notification (inotify / fanotify) attack */
+
+int init_fsnotify_attack(void *arguments);
 
-int init_spawn_attack();
+int fsnotify_attack();
+
+void fsnotify_attack_stats(double secs);
+
+/* Process churn attack, with a bounded pool of children */
+
+int init_spawn_attack(void *arguments);
 
 int spawn_attack();
 
+void spawn_attack_stats(double secs);
+
+/* Thread create / join churn attack */
+
+int init_thread_churn_attack(void *arguments);
+
+int thread_churn_attack();
+
+void thread_churn_attack_stats(double secs);
+
+/* Context switch attack, periodic wakeups on absolute deadlines */
+
+int init_context_switch_attack(void *arguments);
+
+int context_switch_attack();
+
+void context_switch_attack_stats(double secs);
+
+/* Cross-core ping-pong attack (futex / eventfd / pipe) */
+
+int init_pingpong_attack(void *arguments);
+
+int pingpong_attack();
+
+void pingpong_attack_stats(double secs);
+
+/* Interrupt attack: hrtimers, IPIs, migrations and network softirqs */
+
+int init_interrupt_attack(void *arguments);
+
+int interrupt_attack();
+
+void interrupt_attack_stats(double secs);
+
+/* Pipe I/O attack: writer/reader pairs, optionally zero-copy */
+
+int init_pipe_attack(void *arguments);
+
+int pipe_attack();
+
+void pipe_attack_stats(double secs);
+
+/* Virtual memory attack: fault storms, THP splits and RSS balloon */
+
+int init_vm_attack(void *arguments);
+
+int vm_attack();
+
+void vm_attack_stats(double secs);
+
+/* Device attack: /dev/zero, /dev/urandom, /dev/null and /dev/zero mappings */
+
+int init_dev_attack(void *arguments);
+
+int dev_attack();
+
+void dev_attack_stats(double secs);
+
 /* Currently, this function is not implemented,
  * we use UDP attack to contend for network I/O
  */
 int network_attack();
 
+/* Pointer chasing attack: random cycles, independent chains */
+
+int init_pointer_chasing(void *arguments);
+
 int pointer_chasing();
 
+void pointer_chasing_stats(double secs);
+
 /* Disk I/O Attack */
 
 int init_advise_disk_io_attack(void *arguments);
 
 int advise_disk_io_attack();
+
+void advise_disk_io_attack_stats(double secs);
+
+/* Logical block size of the device backing a file, for O_DIRECT */
+int get_logical_block_size(int file);
+
+/* io_uring disk I/O attack with a configurable queue depth */
+
+int init_uring_disk_io_attack(void *arguments);
+
+int uring_disk_io_attack();
+
+void uring_disk_io_attack_stats(double secs);
+
+/* Disk read attack, evicting the page cache behind itself */
+
+int init_disk_read_attack(void *arguments);
+
+int disk_read_attack();
+
+void disk_read_attack_stats(double secs);
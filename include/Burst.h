@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Control.h"
+
+/*
+ * Burst mode: duty-cycled attack threads.
+ *
+ * The attack threads of a process run in on-windows of on_ns every
+ * period_ns, and are parked in between. Window k starts at
+ *     phase_ns + k * period_ns + jitter(k)
+ * in absolute CLOCK_MONOTONIC time, so all threads of the process, and
+ * other instances started with the same parameters, are in phase.
+ * jitter(k) is drawn in [0, jitter_ns] per window, the same for all the
+ * threads of the process, to model a sporadic interferer.
+ *
+ * The gate is attack_continue(): when a thread's on-window is over, it
+ * parks in burst_wait() until the next one. Every primitive is therefore
+ * duty-cycled at the granularity of its work quantum.
+ *
+ * With a trigger source (include/Trigger.h), windows follow the releases
+ * of a victim task instead of the clock.
+ */
+
+/* The thread sleeps until this long before a window, then spins */
+#define BURST_SPIN_NS 50000
+
+typedef struct burst_config {
+    uint64_t on_ns;
+    uint64_t period_ns;
+    uint64_t phase_ns;
+    uint64_t jitter_ns;
+} burst_config_t;
+
+/* Parse "on,period[,phase[,jitter]]", in microseconds (decimals allowed) */
+int burst_parse(const char *spec);
+
+/* Whether burst mode is configured */
+int burst_enabled(void);
+
+/* A trigger source (include/Trigger.h) needs the window length of -b */
+int burst_check_trigger(void);
+
+/* Prepare the control block of a thread entering a primitive */
+void burst_enter(attack_ctl_t *ctl);
+
+/* Account the on-window in progress when the thread leaves its primitive */
+void burst_leave(attack_ctl_t *ctl);
+
+/* Print the achieved duty cycle, release lateness and overrun */
+void burst_print(void);
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "Histogram.h"
+#include "PolyRhythm.h"
+#include "Utils.h"
+
+/*
+ * Stop / switch protocol of the attack threads.
+ *
+ * Every thread that runs a primitive through the registry owns a control
+ * block. Commands are posted by bumping an epoch in one atomic word; the
+ * attack loops compare that word with the last one they acknowledged
+ * (attack_continue()) after every bounded quantum of work, so a command
+ * takes effect within one quantum rather than one full iteration. The
+ * delay from posting to acknowledgement is recorded per command.
+ *
+ * Threads without a control block (helpers spawned by a primitive) only
+ * see the primitive's loop flag, which is still read atomically.
+ */
+
+#define CTL_MAX_THREADS 128
+
+/* Commands, in the low bits of the control word */
+#define CTL_RUN 0    /* Keep running */
+#define CTL_STOP 1   /* Return, the process is exiting */
+#define CTL_SWITCH 2 /* Return, another primitive is selected */
+#define CTL_CMD_BITS 8
+#define CTL_CMD_MASK ((1ULL << CTL_CMD_BITS) - 1)
+
+typedef struct attack_ctl {
+    /* Written by the posters */
+    uint64_t word __attribute__((aligned(64))); /* epoch << 8 | command */
+    uint64_t posted_ns; /* When the current word was posted */
+    uint32_t wake;      /* Futex, bumped on every post */
+
+    /* Written by the owner thread */
+    uint64_t seen __attribute__((aligned(64))); /* Last word acknowledged */
+    int halted; /* A stop or switch was acknowledged */
+    int active; /* Inside a primitive */
+    attack_channel_t channel;
+    latency_hist_t stop_latency;
+    latency_hist_t switch_latency;
+
+    /* Burst mode (include/Burst.h) */
+    uint64_t burst_end_ns;     /* End of the on-window, 0: not bursting */
+    uint64_t burst_release_ns; /* Start of the thread's on time, 0: parked */
+    uint64_t burst_first_ns;   /* First release of this run */
+    uint64_t burst_on_ns;      /* Time run in on-windows, all runs */
+    uint64_t burst_wall_ns;    /* Time since the first release, past runs */
+    uint64_t burst_next_ns;    /* Triggered: start of the pending window */
+    uint32_t burst_seq;        /* Triggered: last victim release seen */
+    latency_hist_t burst_lateness; /* Release after the window start */
+    latency_hist_t burst_overrun;  /* Window end noticed after the end */
+} attack_ctl_t;
+
+/* Control block of the calling thread, NULL outside of a primitive */
+extern __thread attack_ctl_t *attack_self;
+
+/* Slow path of attack_continue(): acknowledge a posted command */
+int ctl_acknowledge(attack_ctl_t *ctl);
+
+/* Slow path of attack_continue(): park until the next on-window
+ * (src/Burst.c) */
+int burst_wait(attack_ctl_t *ctl, int *flag);
+
+/**
+ * @brief Check point of the attack loops
+ * @return 0 when the calling thread must return from its primitive
+ */
+static inline int attack_continue(int *flag) {
+    attack_ctl_t *ctl = attack_self;
+
+    if (ctl != NULL) {
+        if (__atomic_load_n(&ctl->word, __ATOMIC_ACQUIRE) != ctl->seen)
+            return ctl_acknowledge(ctl);
+        if (ctl->halted) return 0;
+        if (ctl->burst_end_ns && get_current_time_ns() >= ctl->burst_end_ns)
+            return burst_wait(ctl, flag);
+    }
+    return __atomic_load_n(flag, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief attack_continue() once every quantum calls, for tight inner loops
+ * @param work: counter owned by the caller
+ * @param quantum: a power of two
+ */
+static inline int attack_continue_every(unsigned int *work,
+                                        unsigned int quantum, int *flag) {
+    if ((++*work & (quantum - 1)) != 0) return 1;
+    return attack_continue(flag);
+}
+
+/* Attach a control block to the calling thread before it runs a primitive */
+attack_ctl_t *ctl_enter(attack_channel_t channel);
+
+/* Detach it once the primitive returned */
+void ctl_leave(void);
+
+/* Post a command to one thread, async-signal-safe */
+void ctl_post(attack_ctl_t *ctl, int cmd);
+
+/* Wake the thread if it is parked, without posting a command */
+void ctl_kick(attack_ctl_t *ctl);
+
+/* Post CTL_STOP to every thread; primitives entered later return at once */
+void ctl_stop_all(void);
+int ctl_stopping(void);
+
+/* True while the thread runs a primitive with no command pending */
+int ctl_busy(attack_ctl_t *ctl);
+
+/* Control blocks handed out so far */
+int ctl_count(void);
+attack_ctl_t *ctl_at(int index);
+
+/* Print the stop and switch latencies of all threads, and the burst mode
+ * statistics */
+void ctl_print_latency(void);
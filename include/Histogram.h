@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Log-bucket latency histogram.
+ * Each power of two is split into HIST_SUB_BUCKETS linear sub-buckets,
+ * so any recorded value is reported with at most 25% relative error.
+ * Recording is a handful of integer operations and never allocates.
+ */
+#define HIST_SUB_BITS 2
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BITS)
+#define HIST_NUM_BUCKETS (64 * HIST_SUB_BUCKETS)
+
+typedef struct latency_hist {
+    uint64_t count;
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+    uint64_t buckets[HIST_NUM_BUCKETS];
+} latency_hist_t;
+
+/* A histogram shared with other processes (SHM_LATENCY, include/Shm.h) */
+typedef struct latency_hist_shm {
+    uint32_t seq;     /* Odd while written, 0: nothing published yet */
+    uint32_t reserved;
+    uint64_t time_ns; /* CLOCK_MONOTONIC time of the last publish */
+    latency_hist_t hist;
+} latency_hist_shm_t;
+
+void hist_reset(latency_hist_t *h);
+
+void hist_record(latency_hist_t *h, uint64_t value);
+
+/* Merge src into dst */
+void hist_merge(latency_hist_t *dst, const latency_hist_t *src);
+
+/* Value below which pct (0-100) percent of the samples fall */
+uint64_t hist_percentile(const latency_hist_t *h, double pct);
+
+/* Print count, mean, p50, p90, p99, p99.9 and max, values in ns */
+void hist_print(const latency_hist_t *h, const char *tag);
+
+/* Copy h into a shared histogram under its sequence lock, single writer */
+void hist_publish(latency_hist_shm_t *dst, const latency_hist_t *h,
+                  uint64_t time_ns);
+
+/* Copy the last published histogram, 0 if there is none yet */
+int hist_read(const latency_hist_shm_t *src, latency_hist_t *h);
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * In-process hardware counters (perf_event_open).
+ *
+ * With -m <scope>, one group of counters is opened per CPU (system-wide)
+ * or on one task, and a sampler thread reads every group at a fixed
+ * period. Rates, scaled for multiplexing, are published in the SHM_PERF
+ * shared memory segment (perf_rates_t) under a sequence lock, so online
+ * search and the RL model get contention signals at millisecond
+ * granularity. Scopes:
+ *
+ *   all        system-wide, one group per online CPU
+ *   pid:<pid>  the task <pid>, e.g. the victim, on any CPU
+ *   self       the attack process, inherited by the attack threads
+ *
+ * Counters the platform lacks (e.g. in a VM) are left out, see
+ * perf_rates_t.available.
+ */
+
+#define PERF_SAMPLE_PERIOD_US 1000  // Default sampling period
+
+enum perf_counter {
+    PERF_CYCLES = 0,
+    PERF_LLC_MISSES,
+    PERF_DTLB_MISSES,
+    PERF_BUS_CYCLES,
+    PERF_CONTEXT_SWITCHES,
+    PERF_NUM_COUNTERS
+};
+
+/* Layout of the SHM_PERF segment (include/Shm.h) */
+typedef struct perf_rates {
+    uint32_t seq;       /* Odd while the sampler writes */
+    uint32_t available; /* Bit i set: counter i is counted */
+    uint64_t time_ns;   /* CLOCK_MONOTONIC time of the last sample */
+    uint64_t interval_ns;               /* Since the previous sample */
+    uint64_t count[PERF_NUM_COUNTERS];  /* Since the start */
+    double rate[PERF_NUM_COUNTERS];     /* Per second, over the interval */
+} perf_rates_t;
+
+/* Parse "<scope>[,<period_us>]" */
+int perf_parse(const char *spec);
+
+/* Whether counters are configured */
+int perf_enabled(void);
+
+/* Open the counters, attach SHM_PERF and start the sampler; before the
+ * attack threads are created, for the self scope */
+int perf_start(void);
+
+/* Copy the last sample, 0 if there is none yet */
+int perf_latest(perf_rates_t *rates);
+
+/* Print the average rates since the start */
+void perf_print(void);
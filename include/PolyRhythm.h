@@ -10,7 +10,6 @@
 #include <time.h>
 #include <unistd.h>
 
-#define NUM_CHANNELS 10
 #define NUM_PARAMS 4  // The maximum number of params used by a channel
 
 /* In PolyRhythm's third phase (reinforcement learning),
@@ -24,11 +23,7 @@
 #include <sys/shm.h>
 #include <sys/types.h>
 
-int shmid_action;
-int shmid_state;
-// give your shared memory an id, anything will do
-#define KEY_ACTION 666644  // Magic number
-#define KEY_STATE 666688   // Magic number
+// Segments are named per instance, see include/Shm.h
 // char *shared_memory_action;
 // char *shared_memory_state;
 
@@ -53,33 +48,29 @@ typedef unsigned long long int ul;
 #define CLASS_VM 6            /* VM stress, big memory, swapping */
 #define CLASS_INTERRUPT 7     /* interrupt floods */
 #define CLASS_MEMORY 8            /* memory bandwidth */
-#define CLASS_PIPE_IO 9       /* pipe I/O */
+#define CLASS_PIPE_IO 9       /* pipe I/O, splice / vmsplice */
 #define CLASS_FILESYSTEM 10   /* file system */
 #define CLASS_DEV 11          /* device (null, zero, etc) */
 #define CLASS_SPAWN 12        /* POSIX thread spawn */
 #define CLASS_PATHOLOGICAL 13 /* can hang a machine */
 #define CLASS_SCHEDULER 14    /* Context Switching */
 #define CLASS_PTR_CHASING 15  /* Pointer chasing */
+#define CLASS_TCP 16          /* TCP stream / connection churn */
+#define CLASS_DISK_URING 17   /* Asynchronous disk I/O (io_uring) */
+#define CLASS_DISK_READ 18    /* Disk reads past the page cache */
+#define CLASS_FSNOTIFY 19     /* inotify / fanotify event storms */
+#define CLASS_THREAD 20       /* Thread create / join churn */
+#define CLASS_PINGPONG 21     /* Cross-core wakeup ping-pong */
 
 typedef unsigned int attack_channel_t;
 
-/* PolyRhythm attack vectors */
-typedef struct attack_channel_info {
-    attack_channel_t attack_channel; /* Class type bit mask */
-    char *name;                      /* Name of class */
-    int num_threads;                 /* Number of threads need to be launch */
-    int (*attack_func)();            /* Main attack function */
-
-    /*
-        Attack parameters
-        All attacks use this array to pass arguments
-        For cache attack, 0 is the stride, 1 is the mem_size, 2 and 3 are null
-        NUM_PARAMS+1 is used because the last parameter is a general parameter,
-        which is used to indicate if we enable online contention region
-       searching
-    */
-    int attack_paras[NUM_PARAMS + 1];
-} attack_channel_info_t;
+/*
+ * Attack primitives are registered in include/Registry.h.
+ * All attacks use an array of NUM_PARAMS + 1 integers to pass arguments:
+ * for the cache attack, 0 is the stride, 1 is the mem_size, 2 and 3 are
+ * null. The last parameter is a general parameter, which is used to
+ * indicate if we enable online contention region searching.
+ */
 
 /* This function is used to switch to different attack channels */
 void *sched_next_tasks();
@@ -87,9 +78,6 @@ void *sched_next_tasks();
 /* Terminate all attacks and print out the states */
 void terminate_and_print_states();
 
-/* Get the nextion attack action e.g., cache, row buffer, etc ... */
-int get_next_action();
-
 /* Disable all flags -- To stop all current attack action */
 void disable_all_flags_rl(int signal);  // For Reinforcement Learning version
 void disable_all_flags();               // For normal version
@@ -100,8 +88,5 @@ int init_shared_memory();
 /* This is main loop for RL */
 void main_attack_loop();
 
-/* Write states into shared memory */
+/* Publish the contention counts as the next state sample (include/RL_Shm.h) */
 int write_states();
-
-/* Write states into shared memory, states are presented by counts */
-int write_states_count();
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <linux/futex.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Perf.h"
+
+/*
+ * Shared memory protocol between rl and the RL agent (RL_DDPG/).
+ *
+ * Both segments start with a magic number and a version, checked by the
+ * side that attaches; bump RL_SHM_VERSION on any layout change.
+ *
+ * SHM_ACTION (include/Shm.h), written by the agent: the channels to run,
+ * as a bit mask in rl_channels[] order (cache, network, row_buffer, disk,
+ * tlb). The mask is one atomic word, the rest of the record is under a
+ * sequence lock (odd while written). The sequence word doubles as a
+ * process-shared futex, woken on every action, for rl to park on while
+ * no channel is selected.
+ *
+ * SHM_STATE, written by rl: a ring of RL_STATE_RING state samples. Each
+ * slot carries the sequence number of its sample, 0 while written; head
+ * is the last sample published. A reader copies slot seq % RL_STATE_RING
+ * and keeps it if the slot held seq before and after the copy.
+ *
+ * All helpers are lock-free and never block the writer.
+ */
+
+#define RL_SHM_MAGIC 0x50524c31 /* "PRL1" */
+#define RL_SHM_VERSION 1
+#define RL_NUM_CHANNELS 5
+#define RL_STATE_RING 64
+
+typedef struct rl_action_shm {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seq;   /* Odd while written */
+    uint32_t mask;  /* Bit i: rl_channels[i] is selected */
+    uint64_t epoch; /* Actions written so far */
+    uint64_t time_ns; /* CLOCK_MONOTONIC time of the last action */
+} rl_action_shm_t;
+
+typedef struct rl_state_sample {
+    uint64_t seq;         /* From 1; 0 while the slot is written */
+    uint64_t time_ns;     /* CLOCK_MONOTONIC */
+    uint64_t interval_ns; /* Since the previous sample */
+    uint64_t action_epoch; /* Action in effect when sampled */
+    uint32_t action_mask;
+    uint32_t perf_available; /* perf_rates_t.available, 0: no -m */
+    uint64_t count[RL_NUM_CHANNELS]; /* Contention counts in the interval */
+    double state[RL_NUM_CHANNELS];   /* Normalized counts, the model input */
+    double perf_rate[PERF_NUM_COUNTERS]; /* include/Perf.h, per second */
+} rl_state_sample_t;
+
+typedef struct rl_state_shm {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t ring_len;
+    uint32_t sample_size;
+    uint64_t head __attribute__((aligned(64))); /* Last seq published */
+    rl_state_sample_t ring[RL_STATE_RING] __attribute__((aligned(64)));
+} rl_state_shm_t;
+
+static inline void rl_action_init(rl_action_shm_t *a) {
+    a->magic = RL_SHM_MAGIC;
+    a->version = RL_SHM_VERSION;
+}
+
+static inline void rl_state_init(rl_state_shm_t *s) {
+    memset(s, 0, sizeof(*s));
+    s->ring_len = RL_STATE_RING;
+    s->sample_size = sizeof(rl_state_sample_t);
+    s->version = RL_SHM_VERSION;
+    __atomic_store_n(&s->magic, RL_SHM_MAGIC, __ATOMIC_RELEASE);
+}
+
+/* Whether a segment attached by the other side has this layout */
+static inline int rl_shm_compatible(uint32_t magic, uint32_t version) {
+    return magic == RL_SHM_MAGIC && version == RL_SHM_VERSION;
+}
+
+/**
+ * @brief Publish an action, single writer
+ */
+static inline void rl_action_write(rl_action_shm_t *a, uint32_t mask,
+                                   uint64_t now) {
+    uint32_t seq = __atomic_load_n(&a->seq, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&a->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&a->epoch, a->epoch + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&a->time_ns, now, __ATOMIC_RELAXED);
+    __atomic_store_n(&a->mask, mask, __ATOMIC_RELEASE);
+    __atomic_store_n(&a->seq, seq + 2, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &a->seq, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+}
+
+/**
+ * @brief Wait until the action sequence moves on from seq, or timeout_ns
+ */
+static inline void rl_action_wait(rl_action_shm_t *a, uint32_t seq,
+                                  uint64_t timeout_ns) {
+    struct timespec timeout = {.tv_sec = timeout_ns / 1000000000ULL,
+                               .tv_nsec = timeout_ns % 1000000000ULL};
+
+    syscall(SYS_futex, &a->seq, FUTEX_WAIT, seq, &timeout, NULL, 0);
+}
+
+/**
+ * @brief Read the whole action record
+ */
+static inline void rl_action_read(const rl_action_shm_t *a, uint32_t *mask,
+                                  uint64_t *epoch, uint64_t *time_ns) {
+    uint32_t seq;
+
+    do {
+        while ((seq = __atomic_load_n(&a->seq, __ATOMIC_ACQUIRE)) & 1)
+            ;
+        *mask = __atomic_load_n(&a->mask, __ATOMIC_RELAXED);
+        *epoch = __atomic_load_n(&a->epoch, __ATOMIC_RELAXED);
+        *time_ns = __atomic_load_n(&a->time_ns, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&a->seq, __ATOMIC_RELAXED) != seq);
+}
+
+/**
+ * @brief Publish a sample as the next one, single writer
+ * @return its sequence number
+ */
+static inline uint64_t rl_state_publish(rl_state_shm_t *s,
+                                        rl_state_sample_t *sample) {
+    uint64_t seq = __atomic_load_n(&s->head, __ATOMIC_RELAXED) + 1;
+    rl_state_sample_t *slot = &s->ring[seq % RL_STATE_RING];
+
+    __atomic_store_n(&slot->seq, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    sample->seq = 0;
+    memcpy(slot, sample, sizeof(*slot));
+    __atomic_store_n(&slot->seq, seq, __ATOMIC_RELEASE);
+    __atomic_store_n(&s->head, seq, __ATOMIC_RELEASE);
+
+    sample->seq = seq;
+    return seq;
+}
+
+/**
+ * @brief Copy sample seq, if it is still in the ring
+ * @return 1 on success, 0 if it is not published yet or was overwritten
+ */
+static inline int rl_state_read(const rl_state_shm_t *s, uint64_t seq,
+                                rl_state_sample_t *sample) {
+    const rl_state_sample_t *slot = &s->ring[seq % RL_STATE_RING];
+    uint64_t head = __atomic_load_n(&s->head, __ATOMIC_ACQUIRE);
+
+    if (seq == 0 || seq > head || head - seq >= RL_STATE_RING) return 0;
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != seq) return 0;
+    memcpy(sample, slot, sizeof(*sample));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&slot->seq, __ATOMIC_RELAXED) == seq &&
+           sample->seq == seq;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "PolyRhythm.h"
+
+/*
+ * Registry of attack primitives, shared by polyrhythm and rl.
+ *
+ * Every primitive registers a descriptor: its channel id (CLASS_*), its
+ * command-line name, default parameters and a vtable. The registry keeps
+ * one context per primitive, indexed by id, so dispatching an RL action
+ * or a scheduler slot is a table lookup.
+ *
+ * Most primitives are written against a global loop flag, with an
+ * init_X_attack(void *) and an X_attack() function. They only need to
+ * fill init_func, attack_func and flag (and stats_func if they report):
+ * the vtable entries left NULL are filled with defaults that drive them.
+ *
+ * The registry accounts for the time each primitive ran, and at exit
+ * calls the stats hook of every primitive that ran, to print its totals.
+ *
+ * Primitives can also come from shared objects listed (':'-separated) in
+ * the POLYRHYTHM_PLUGINS environment variable. A plugin exports
+ *     const primitive_desc_t *polyrhythm_primitives(int *count);
+ * which returns an array of descriptors to register.
+ */
+
+#define MAX_PRIMITIVES 64  // Channel ids must be below this
+
+typedef struct primitive_ctx primitive_ctx_t;
+
+/* Descriptor of an attack primitive */
+typedef struct primitive_desc {
+    attack_channel_t id;                 /* CLASS_* */
+    const char *name;                    /* Name on the command line */
+    int default_params[NUM_PARAMS + 1];  /* The last one is the online flag */
+    int max_threads;                     /* 0: no limit */
+
+    /* Vtable */
+    int (*init)(primitive_ctx_t *ctx, int *params);  /* Before any thread */
+    int (*run)(primitive_ctx_t *ctx);           /* Attack loop of a thread */
+    void (*request_stop)(primitive_ctx_t *ctx); /* Make every run() return */
+    void (*stats)(primitive_ctx_t *ctx);        /* Optional, print totals */
+
+    /* Flag-driven primitives */
+    int (*init_func)(void *arguments);
+    int (*attack_func)();
+    int *flag;
+    void (*stats_func)(double secs);  /* Totals over secs of running */
+} primitive_desc_t;
+
+/* Run-time state of a registered primitive */
+struct primitive_ctx {
+    primitive_desc_t desc;
+    int params[NUM_PARAMS + 1];
+    int num_threads;  /* Threads requested on the command line */
+    int pending;      /* Threads left to launch */
+    void *priv;       /* Owned by the primitive */
+
+    /* Run time accounting, under the registry's lock */
+    int active;            /* Threads inside run() */
+    int runs;              /* run() calls so far */
+    uint64_t active_ns;    /* Time with at least one thread inside run() */
+    uint64_t active_since; /* Start of the current active period */
+};
+
+/* Register one primitive, fails on a duplicate or out-of-range id */
+int register_primitive(const primitive_desc_t *desc);
+
+/* Register the primitives built into PolyRhythm (src/Primitives.c) */
+void register_builtin_primitives(void);
+
+/* Register the primitives of the plugins in POLYRHYTHM_PLUGINS */
+int load_primitive_plugins(void);
+
+/* Lookups, NULL when nothing is registered there */
+primitive_ctx_t *get_primitive(attack_channel_t id);
+primitive_ctx_t *find_primitive(const char *name);
+
+/* Registered primitives, in registration order */
+int num_primitives(void);
+primitive_ctx_t *primitive_at(int index);
+
+/* Call init with the context's parameters, and arm its threads */
+int init_primitive(primitive_ctx_t *ctx);
+
+/* Run the primitive in the calling thread, which gets a control block
+ * (include/Control.h) for the duration of the run */
+int run_primitive(primitive_ctx_t *ctx);
+
+/* Claim one pending thread of the first primitive that has one, and run
+ * it in the calling thread. Returns EXIT_FAILURE if none is pending. */
+int run_next_primitive(void);
+
+/* Ask every registered primitive to stop, async-signal-safe as long as
+ * the request_stop hooks are */
+void stop_all_primitives(void);
+
+/* Seconds during which at least one thread ran the primitive */
+double primitive_active_secs(primitive_ctx_t *ctx);
+
+/* Call the stats hook of every primitive that ran */
+void print_primitive_stats(void);
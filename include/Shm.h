@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+
+/*
+ * Shared memory segments of one PolyRhythm instance.
+ *
+ * Segments are POSIX shared memory objects named
+ *     /polyrhythm.<instance>.<segment>
+ * (files under /dev/shm), so that several rl or polyrhythm processes, and
+ * several experiments on one host, each get their own. The instance name
+ * is set with -i, or else taken from the POLYRHYTHM_INSTANCE environment
+ * variable, and defaults to "0". The RL agent attaches the same names
+ * (RL_DDPG/C-extension builds this file too).
+ *
+ * Segments outlive the processes; remove them with
+ *     rm /dev/shm/polyrhythm.<instance>.*
+ */
+
+#define SHM_INSTANCE_ENV "POLYRHYTHM_INSTANCE"
+#define SHM_INSTANCE_DEFAULT "0"
+#define SHM_INSTANCE_MAX 64
+
+/*
+ * Segments, and their layout. Every record is written by one process
+ * under a sequence lock (odd while written), so readers in other
+ * processes retry instead of copying a torn record.
+ */
+#define SHM_ACTION "action"   // RL action (rl_action_shm_t, RL_Shm.h)
+#define SHM_STATE "state"     // RL state ring (rl_state_shm_t, RL_Shm.h)
+#define SHM_LATENCY "latency" // Load latency (latency_hist_shm_t, Histogram.h)
+#define SHM_PERF "perf"       // Hardware counter rates (perf_rates_t, Perf.h)
+
+/* Set the instance name of this process: letters, digits, '_', '-', '.' */
+int shm_set_instance(const char *instance);
+
+/* Instance name of this process */
+const char *shm_instance(void);
+
+/* Name of a segment, "/polyrhythm.<instance>.<segment>" */
+int shm_name(char *buf, size_t len, const char *instance,
+             const char *segment);
+
+/* Map a segment of at least size bytes, creating it (mode 0666) if
+ * create is set; NULL with errno set on failure */
+void *shm_map(const char *instance, const char *segment, size_t size,
+              int create);
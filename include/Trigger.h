@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+
+/*
+ * Victim-release triggers for burst mode (include/Burst.h).
+ *
+ * With -t <source>, a burst window starts phase (+ jitter) after each
+ * release of the victim, instead of on a fixed period, and lasts on; the
+ * burst period becomes the minimum spacing between two windows. Between
+ * windows the attack threads stay parked, so a budget-limited attacker
+ * (e.g. SCHED_DEADLINE under rt-launcher) spends its runtime while the
+ * victim executes. Sources:
+ *
+ *   shm:<key>    SysV shared memory holding a uint32_t counter at offset 0,
+ *                incremented by the victim at every release; polled
+ *   futex:<key>  the same counter, after which the victim also calls
+ *                FUTEX_WAKE (not private) on it; no polling
+ *   pipe:<path>  FIFO, the victim writes a byte at every release
+ *   proc:<pid>   /proc/<pid>/stat sampled for the task entering the R state
+ *
+ * The shm and futex sources create the segment if the victim has not.
+ */
+
+#define TRIGGER_POLL_NS 10000  // Sampling period of shm and proc sources
+
+/* Parse and open the source */
+int trigger_parse(const char *spec);
+
+/* Whether a trigger source is configured */
+int trigger_enabled(void);
+
+/* Start the watcher thread, releases closer than min_spacing_ns to the
+ * previous one are ignored */
+int trigger_start(uint64_t min_spacing_ns);
+
+/* Latest release: its sequence number (0: none yet) and time */
+uint32_t trigger_last(uint64_t *release_ns);
+
+/* Name of the source, for reports */
+const char *trigger_name(void);
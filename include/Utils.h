@@ -14,11 +14,11 @@
 #define NANOSEC 1000000000L
 
 #define MIN(X, Y) (((X) < (Y)) ? (X) : (Y))
+#define MAX(X, Y) (((X) > (Y)) ? (X) : (Y))
 
-int parse_options(int argc, char *argv[],
-                  attack_channel_info_t attack_channels[]);
+int parse_options(int argc, char *argv[]);
 
-int print_options(attack_channel_info_t attack_channels[]);
+int print_options(void);
 
 void rand_str(char *, size_t);
 
@@ -36,6 +36,8 @@ void maccess(void *p);
 
 long get_current_time_us(void);
 
+uint64_t get_current_time_ns(void);
+
 void printRusage(const struct rusage *ru);
 
 char **str_split(char *a_str, const char a_delim);
@@ -55,6 +55,11 @@
    1ms deadline It is launched with 2 arguments: python3 DDPG.py Its instance is
    on core 0.
 
+    In the arguments of a command, {pidN} is replaced by the PID of the first
+    instance of program N, which must come before. An attacker can thereby
+    be triggered by a victim launched with it, e.g. with
+        1 d 10 10 6 ./polyrhythm -b 500,2000 -t proc:{pid0} ...
+
     The launcher forks all children, which wait on a pipe to proceed.
     It sets their core affinity and scheduling attributes as needed.
     Once all children are launched,
@@ -87,6 +92,7 @@ int g_argc;                // Number of command-line arguments
 int arg_idx;               // Current command-line argument index
 int num_children;          // Total number of child processes launched
 int pipefd[2];             // Pipe for synchronization
+int *first_pids;           // PID of the first instance of each program
 char cgroup_filename[64];  // String for cgroup path
 char cgroup_value[64];     // String for cgroup values
 
@@ -123,6 +129,33 @@ struct sched_attr {
     unsigned long long sched_period;
 };
 
+/**
+ * Replace {pidN} in a child argument by the PID of program N, which was
+ * forked before program prog. Returns the argument itself if it has none.
+ */
+static char *expand_pids(char *s, int prog) {
+    char *out, *o, *p;
+    int n, len;
+
+    if (!strstr(s, "{pid")) return s;
+
+    // {pidN} takes 6 characters or more, a PID at most 10 digits
+    out = o = (char *)malloc(strlen(s) * 3 + 1);
+    if (!out) return s;
+
+    for (p = s; *p;) {
+        if (sscanf(p, "{pid%d}%n", &n, &len) == 1 && len > 0 && n >= 0 &&
+            n < prog) {
+            o += sprintf(o, "%d", first_pids[n]);
+            p += len;
+        } else {
+            *o++ = *p++;
+        }
+    }
+    *o = '\0';
+    return out;
+}
+
 // Initialize a sched_attr struct
 #define SCHED_ATTR(sa)          \
     struct sched_attr sa;       \
@@ -218,6 +251,11 @@ int main(int argc, char *argv[]) {
     }
     printf("Number of programs: %d\n", num_programs);
 
+    first_pids = (int *)calloc(num_programs, sizeof(int));
+    if (!first_pids) {
+        parent_exit("Failed to malloc array for child PIDs!\n");
+    }
+
     // Iterate through each program to set it up
     for (int prog = 0; prog < num_programs; prog++) {
         // Num of instances
@@ -332,6 +370,7 @@ int main(int argc, char *argv[]) {
             // Parent
             if (pid) {
                 printf("Forked with PID %d\n", pid);
+                if (instance == 0) first_pids[prog] = pid;
 
                 // Set scheduling attribute if not CFS
                 if (scheduler != 'c') {
@@ -418,6 +457,10 @@ int main(int argc, char *argv[]) {
                 }
 
                 // Parent success, exec command
+                for (int child_arg = 0; child_argv[child_arg]; child_arg++) {
+                    child_argv[child_arg] =
+                        expand_pids(child_argv[child_arg], prog);
+                }
                 execvp(child_argv[0], child_argv);
             }
         }
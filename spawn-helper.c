@@ -0,0 +1,20 @@
+/*
+
+    Tiny helper executed by the spawn primitive (posix_spawn method).
+
+    Command-line looks like this:
+
+    ./spawn_helper [lifetime]
+
+    Sleeps for <lifetime> microseconds, then exits. It is linked statically
+    when possible, so that exec does not pay for the dynamic loader.
+
+*/
+
+#include <stdlib.h>
+#include <unistd.h>
+
+int main(int argc, char *argv[]) {
+    if (argc > 1) usleep(atoi(argv[1]));
+    return 0;
+}
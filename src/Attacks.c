@@ -4,6 +4,7 @@
 #include <errno.h>
 #include <time.h>
 
+#include "Control.h"
 #include "PolyRhythm.h"
 #include "Utils.h"
 
@@ -16,13 +17,10 @@
 #include <string.h>
 #include <sys/mman.h>
 
-/* spwan attack */
-#include <spawn.h>
-
 /* Memory contention */
 #include <pthread.h>
 
-/* File sytem & Disk IO contention */
+/* Disk IO contention */
 #include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -37,194 +35,6 @@ struct itimerval timer;
 
 /* All extern trigger flags */
 extern int memory_ops_flag;
-extern int context_switch_flag;
-
-/*************************************
- * File system attack
- * Performing  file  system  activities  such  as  making/deleting
- * files/directories, moving files, etc.
- * to block the kernel shared data structures and
- * stress various notify events
- * ***********************************
- */
-
-/*
- *
- *	Create file of length len bytes
- *
- */
-
-#define FILE_WRITE_SIZE (4096)
-static int create_file(const char *filename) {
-    int fd;
-    char buffer[FILE_WRITE_SIZE];
-
-    if ((fd = open(filename, O_CREAT | O_RDWR)) < 0) {
-        if ((errno == ENFILE) || (errno == ENOMEM) || (errno == ENOSPC))
-            return EXIT_FAILURE;
-        printf("Cannot create file %s: errno=%d (%s)\n", filename, errno,
-               strerror(errno));
-        return EXIT_FAILURE;
-    }
-
-    (void)memset(buffer, 'x', FILE_WRITE_SIZE);
-
-    ssize_t ret;
-
-    ret = write(fd, buffer, FILE_WRITE_SIZE);
-    if (ret < 0) {
-        printf("Error writing to file %s: errno=%d (%s)\n", filename, errno,
-               strerror(errno));
-        (void)close(fd);
-        return EXIT_FAILURE;
-    }
-
-    close(fd);
-    return EXIT_SUCCESS;
-}
-
-/*
- *	remove a file
- */
-int remove_file(const char *pathname) { return unlink(pathname); }
-
-/*
- *	access a file by reading
- */
-static int access_file(const char *path) {
-    int fd;
-    char buffer[1];
-    int rc = 0;
-
-    if ((fd = open(path, O_RDONLY)) < 0) {
-        printf("File open error\n");
-        return EXIT_FAILURE;
-    }
-
-do_access:
-    if ((read(fd, buffer, 1) < 0)) {
-        if ((errno == EAGAIN) || (errno == EINTR)) goto do_access;
-        printf("Cannot access the file %s\n", path);
-        rc = -1;
-    }
-    (void)close(fd);
-    return rc;
-}
-
-/*
- *	move
- */
-static int move_file(const char *oldpath, const char *newpath) {
-    if (rename(oldpath, newpath) < 0) {
-        printf("Cannot rename %s to %s: errno=%d (%s)\n", oldpath, newpath,
-               errno, strerror(errno));
-        return EXIT_FAILURE;
-    }
-    return EXIT_SUCCESS;
-}
-
-/* Parameters for file system attack */
-
-/* Four actions: access, create, delete, move */
-
-typedef enum { CREATE = 0, MOVE, DELETE, ACCESS } file_op;
-
-static file_op mode;
-
-int init_filesys_attack(void *arguments) {
-    int *args = (int *)arguments;
-    mode = args[0];  // What type of operation
-}
-
-int filesys_attack() {
-    int i;
-    char tmp_create_filename[] = {[41] = '\1'};
-    char *access_filenames[100];
-
-    switch (mode) {
-        case CREATE:
-            /* */
-            while (1) {
-                rand_str(tmp_create_filename, sizeof(tmp_create_filename) - 1);
-                create_file(tmp_create_filename);
-            }
-            break;
-        case ACCESS:
-            /* */
-            for (i = 0; i < 100; i++) {
-                access_filenames[i][41] = '\1';
-                rand_str(access_filenames[i], sizeof(access_filenames[i]) - 1);
-                create_file(access_filenames[i]);
-            }
-            while (1) {
-                i = rand() % 100;  // Randomly access these files
-                access_file(access_filenames[i]);
-            }
-            break;
-        default:
-            break;
-    }
-
-    /* operation on inodes */
-    return EXIT_SUCCESS;
-}
-
-/*************************************
- * Parameters for spawn attack //TO FIX
- * ***********************************
- */
-
-#define PATH_MAX 4096     /* # chars in a path name including nul */
-
-int max_THREAD = 0;
-extern char **environ;  // A dummy parameters for posix_spawn()
-char *argv[] = {"spawn", "2", "1",
-                "1",     "1", "1"};  // parameters for posix_spawn()
-
-/**
- * @brief Initialize spawn attack channels
- * @param:
- * 0: number of max number of threads
- */
-int init_spawn_attack(void *arguments) {
-    int *args = (int *)arguments;
-    max_THREAD = args[0];
-    return EXIT_SUCCESS;
-}
-
-int spawn_attack() {
-    printf("[ForkBomb] Spwan attack begin \n");
-    int thread_count = 0;
-    char path[PATH_MAX];  // why + 1, 4096 is including nul
-    unsigned int len;
-
-    /* Determine our own self as the spawnutable */
-    len = readlink("/proc/self/exe", path, sizeof(path));
-
-    pid_t tmp_pid;
-
-    while (1) {
-        int ret;
-        pid_t pid;
-        ret = posix_spawn(&tmp_pid, path, NULL, NULL, argv, environ);
-        if (ret < 0) {
-            printf("Spawn: posix_spawn failed, errno=%d (%s)\n", errno,
-                   strerror(errno));
-            return EXIT_FAILURE;
-        }
-        thread_count++;
-        printf("Spwan succeded \n");
-
-        if (thread_count > max_THREAD) {
-            // break;
-            while (1) {
-            }
-        }
-    }
-
-    printf("spwan end \n");
-    return EXIT_SUCCESS;
-}
 
 /*************************************
  * Parameters for disk io attack *****
@@ -328,7 +138,7 @@ void stress_memory_bus_contention(void *data) {
     int tmp_count = 0;
     long int timing = 0;
 
-    while (memory_ops_flag) {
+    while (attack_continue(&memory_ops_flag)) {
         long start = get_current_time_us();
 
         for (i = 0; i < 1024; i++) {
@@ -576,29 +386,3 @@ void stress_memory_bus_contention(void *data) {
         pthread_join(pthreads[0], NULL);
         return EXIT_SUCCESS;
     }
-
-    /********************************************
-     * Parameters for context switch attack *****
-     *
-     * Implements a context switching attack
-     * If run by a high-priority attacker with utilization constrained,
-     * it should induce a large number of context switches in the victim
-     *
-     * Sets a timer for length DURATION,
-     * which suspends the attacking thread for that amount of time
-     *
-     * This forces rapid context switching between attacker and victim
-     * without using much of the attacker's given bandwidth/utilization
-     *
-     * ******************************************
-     */
-
-    static int context_switch_duration;
-
-    int context_switch_attack() {
-        while (context_switch_flag) {
-            if (usleep(context_switch_duration)) return EXIT_FAILURE;
-        }
-
-        return EXIT_SUCCESS;
-    }
\ No newline at end of file
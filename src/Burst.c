@@ -0,0 +1,313 @@
+#include "Burst.h"
+
+#include <linux/futex.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Trigger.h"
+#include "Utils.h"
+
+#define BURST_REPORT_INTERVAL_NS NANOSEC
+
+static burst_config_t burst;
+static uint64_t jitter_seed;
+
+/**
+ * @brief Parse the burst parameters
+ * @spec: "on,period[,phase[,jitter]]", in microseconds, e.g. "200,1000"
+ */
+int burst_parse(const char *spec) {
+    double values[4] = {0, 0, 0, 0};
+    char *copy = strdup(spec), *token, *save, *end;
+    int n = 0;
+
+    for (token = strtok_r(copy, ",", &save); token != NULL;
+         token = strtok_r(NULL, ",", &save)) {
+        if (n == 4) {
+            n = 0;
+            break;
+        }
+        values[n] = strtod(token, &end);
+        if (end == token || *end != '\0' || values[n] < 0) {
+            n = 0;
+            break;
+        }
+        n++;
+    }
+    free(copy);
+
+    if (n < 2) {
+        printf("Burst: expected on,period[,phase[,jitter]] in us, got %s \n",
+               spec);
+        return EXIT_FAILURE;
+    }
+
+    burst.on_ns = (uint64_t)(values[0] * 1000);
+    burst.period_ns = (uint64_t)(values[1] * 1000);
+    burst.phase_ns = (uint64_t)(values[2] * 1000);
+    burst.jitter_ns = (uint64_t)(values[3] * 1000);
+
+    if (burst.on_ns == 0 || burst.on_ns > burst.period_ns ||
+        burst.jitter_ns > burst.period_ns - burst.on_ns) {
+        printf("Burst: need 0 < on <= period and jitter <= period - on \n");
+        memset(&burst, 0, sizeof(burst));
+        return EXIT_FAILURE;
+    }
+    burst.phase_ns %= burst.period_ns;
+
+    /* Same jitter for the threads of this process, not for other ones */
+    jitter_seed = (uint64_t)getpid() * 0x9E3779B97F4A7C15ULL;
+    return EXIT_SUCCESS;
+}
+
+int burst_enabled(void) { return burst.on_ns != 0; }
+
+int burst_check_trigger(void) {
+    if (trigger_enabled() && !burst_enabled()) {
+        printf("Burst: -t needs -b to set the window length \n");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Release jitter of window k, in [0, jitter_ns] (splitmix64)
+ */
+static uint64_t window_jitter(uint64_t k) {
+    uint64_t z = k + jitter_seed;
+
+    if (burst.jitter_ns == 0) return 0;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    return z % (burst.jitter_ns + 1);
+}
+
+/**
+ * @brief The window in progress at now, or else the next one
+ * @return 0 when triggered and no window is pending
+ */
+static int next_window(attack_ctl_t *ctl, uint64_t now, uint64_t *start,
+                       uint64_t *end) {
+    uint64_t k, release_ns;
+    uint32_t seq;
+
+    if (trigger_enabled()) {
+        /* One window per victim release; a window already over is lost */
+        seq = trigger_last(&release_ns);
+        if (seq != ctl->burst_seq) {
+            ctl->burst_seq = seq;
+            ctl->burst_next_ns = release_ns + burst.phase_ns +
+                                 window_jitter(seq);
+        }
+        if (ctl->burst_next_ns == 0) return 0;
+        *start = ctl->burst_next_ns;
+        *end = *start + burst.on_ns;
+        if (now >= *end) ctl->burst_next_ns = 0;
+        return now < *end;
+    }
+
+    k = now < burst.phase_ns ? 0 : (now - burst.phase_ns) / burst.period_ns;
+    *start = burst.phase_ns + k * burst.period_ns + window_jitter(k);
+    if (now >= *start + burst.on_ns) {
+        k++;
+        *start = burst.phase_ns + k * burst.period_ns + window_jitter(k);
+    }
+    *end = *start + burst.on_ns;
+    return 1;
+}
+
+static inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    asm volatile("pause" ::: "memory");
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#else
+    asm volatile("" ::: "memory");
+#endif
+}
+
+/**
+ * @brief Sleep until the absolute CLOCK_MONOTONIC deadline (0: none), or
+ * until the control block is posted to or kicked
+ */
+static void park(attack_ctl_t *ctl, uint32_t wake, uint64_t deadline) {
+    struct timespec ts = {.tv_sec = deadline / NANOSEC,
+                          .tv_nsec = deadline % NANOSEC};
+
+    /* FUTEX_WAIT_BITSET takes an absolute CLOCK_MONOTONIC timeout */
+    syscall(SYS_futex, &ctl->wake, FUTEX_WAIT_BITSET_PRIVATE, wake,
+            deadline ? &ts : NULL, NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+/**
+ * @brief Once per second, the first thread reports the duty cycle
+ * achieved by all bursting threads since the last report
+ */
+static void report_duty(uint64_t now) {
+    static uint64_t last_report, last_on;
+    static uint32_t last_seq;
+    uint64_t on = 0, release_ns;
+    uint32_t seq = trigger_last(&release_ns);
+    int i, threads = 0;
+
+    if (now - last_report < BURST_REPORT_INTERVAL_NS) return;
+
+    for (i = 0; i < ctl_count(); i++) {
+        attack_ctl_t *c = ctl_at(i);
+
+        on += __atomic_load_n(&c->burst_on_ns, __ATOMIC_RELAXED);
+        if (__atomic_load_n(&c->active, __ATOMIC_ACQUIRE) &&
+            __atomic_load_n(&c->burst_first_ns, __ATOMIC_RELAXED))
+            threads++;
+    }
+
+    if (last_report && threads && trigger_enabled()) {
+        printf("[Burst] %.1fus on after each release of %s: duty cycle "
+               "%.1f%%, %.1f releases/s over %d threads \n",
+               burst.on_ns / 1000.0, trigger_name(),
+               100.0 * (on - last_on) / ((now - last_report) * threads),
+               (double)(seq - last_seq) * NANOSEC / (now - last_report),
+               threads);
+    } else if (last_report && threads) {
+        printf("[Burst] %.1fus on every %.1fus: duty cycle %.1f%% "
+               "(target %.1f%%) over %d threads \n",
+               burst.on_ns / 1000.0, burst.period_ns / 1000.0,
+               100.0 * (on - last_on) / ((now - last_report) * threads),
+               100.0 * burst.on_ns / burst.period_ns, threads);
+    }
+    last_report = now;
+    last_on = on;
+    last_seq = seq;
+}
+
+static void start_trigger(void) {
+    (void)trigger_start(burst.period_ns);
+}
+
+void burst_enter(attack_ctl_t *ctl) {
+    static __thread int slack_set;
+    static pthread_once_t trigger_once = PTHREAD_ONCE_INIT;
+
+    if (!burst_enabled()) {
+        ctl->burst_end_ns = 0;
+        return;
+    }
+
+    /* Default timer slack (50us) would delay every release */
+    if (!slack_set) {
+        (void)prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+        slack_set = 1;
+    }
+
+    if (trigger_enabled()) pthread_once(&trigger_once, start_trigger);
+
+    /* Already expired: the first check parks until a window */
+    ctl->burst_end_ns = 1;
+    ctl->burst_next_ns = 0;
+    ctl->burst_seq = 0;
+    ctl->burst_release_ns = 0;
+    __atomic_store_n(&ctl->burst_first_ns, 0, __ATOMIC_RELAXED);
+}
+
+void burst_leave(attack_ctl_t *ctl) {
+    uint64_t now = get_current_time_ns();
+
+    if (!ctl->burst_end_ns) return;
+    if (ctl->burst_release_ns) {
+        __atomic_fetch_add(&ctl->burst_on_ns, now - ctl->burst_release_ns,
+                           __ATOMIC_RELAXED);
+    }
+    if (ctl->burst_first_ns) {
+        __atomic_fetch_add(&ctl->burst_wall_ns, now - ctl->burst_first_ns,
+                           __ATOMIC_RELAXED);
+    }
+    ctl->burst_end_ns = 0;
+    ctl->burst_release_ns = 0;
+    __atomic_store_n(&ctl->burst_first_ns, 0, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief The on-window of the thread is over: account for it, then park
+ * until the next window, sleeping and then spinning the last
+ * BURST_SPIN_NS. Stops and switches posted meanwhile wake the thread, and
+ * so do victim releases when triggered.
+ * @return as attack_continue()
+ */
+int burst_wait(attack_ctl_t *ctl, int *flag) {
+    uint64_t now = get_current_time_ns(), start, end;
+
+    if (ctl->burst_release_ns) {
+        hist_record(&ctl->burst_overrun, now - ctl->burst_end_ns);
+        __atomic_fetch_add(&ctl->burst_on_ns, now - ctl->burst_release_ns,
+                           __ATOMIC_RELAXED);
+        ctl->burst_release_ns = 0;
+    }
+
+    for (;;) {
+        /* Read before the window, so a release in between is not lost */
+        uint32_t wake = __atomic_load_n(&ctl->wake, __ATOMIC_ACQUIRE);
+
+        if (__atomic_load_n(&ctl->word, __ATOMIC_ACQUIRE) != ctl->seen)
+            return ctl_acknowledge(ctl);
+        if (!__atomic_load_n(flag, __ATOMIC_RELAXED)) return 0;
+
+        if (!next_window(ctl, now, &start, &end)) {
+            park(ctl, wake, 0);
+        } else if (now >= start) {
+            break;
+        } else if (start - now > BURST_SPIN_NS) {
+            park(ctl, wake, start - BURST_SPIN_NS);
+        } else {
+            cpu_relax();
+        }
+        now = get_current_time_ns();
+    }
+
+    /* Released; the first window may have been joined halfway through */
+    if (ctl->burst_first_ns) {
+        hist_record(&ctl->burst_lateness, now - start);
+    } else {
+        __atomic_store_n(&ctl->burst_first_ns, now, __ATOMIC_RELAXED);
+    }
+    ctl->burst_release_ns = now;
+    ctl->burst_end_ns = end;
+    ctl->burst_next_ns = 0; /* Consumed, when triggered */
+
+    if (ctl == ctl_at(0)) report_duty(now);
+    return __atomic_load_n(flag, __ATOMIC_RELAXED);
+}
+
+void burst_print(void) {
+    latency_hist_t lateness, overrun;
+    uint64_t on = 0, wall = 0, release_ns;
+    int i;
+
+    hist_reset(&lateness);
+    hist_reset(&overrun);
+    for (i = 0; i < ctl_count(); i++) {
+        attack_ctl_t *c = ctl_at(i);
+
+        on += __atomic_load_n(&c->burst_on_ns, __ATOMIC_RELAXED);
+        wall += __atomic_load_n(&c->burst_wall_ns, __ATOMIC_RELAXED);
+        if (c->burst_lateness.count)
+            hist_merge(&lateness, &c->burst_lateness);
+        if (c->burst_overrun.count) hist_merge(&overrun, &c->burst_overrun);
+    }
+
+    if (wall && trigger_enabled()) {
+        printf("[Burst] achieved duty cycle %.2f%% over %u releases of %s \n",
+               100.0 * on / wall, trigger_last(&release_ns), trigger_name());
+    } else if (wall) {
+        printf("[Burst] achieved duty cycle %.2f%% (target %.2f%%) \n",
+               100.0 * on / wall, 100.0 * burst.on_ns / burst.period_ns);
+    }
+    if (lateness.count) hist_print(&lateness, "Burst release lateness");
+    if (overrun.count) hist_print(&overrun, "Burst overrun");
+}
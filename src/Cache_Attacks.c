@@ -7,6 +7,7 @@
 #include <time.h>
 
 #include "Attacks.h"
+#include "Control.h"
 #include "Utils.h"
 
 /*** Raspberry pi 3b ***/
@@ -17,6 +18,9 @@
 // Specify the number of loops last approximate 5ms
 #define CACHE_ITERATIONS 30
 
+// Cache lines written between two checks for a stop or switch (256 KB)
+#define CACHE_QUANTUM 4096
+
 /*
  * Parameters:
  * stride: how many cache line skip while evicting the memory
@@ -28,7 +32,6 @@
  * To stop attack primitives
  */
 extern int cache_flag;
-extern struct action *shared_memory_action;
 
 /* feedbacks for RL, defined in PolyRhythm_RL.c */
 extern unsigned long int cache_contention_count;
@@ -120,19 +123,20 @@ int cache_attack() {
 #endif
 
     register unsigned int sum = 0;
+    unsigned int work = 0;
 
     /* Attack loop */
 #ifdef RL_ONLINE
 
 #ifdef TIMER
-    while (shared_memory_action->cache) {
+    while (attack_continue(&cache_flag)) {
 #else
     for (int it = 0; it < CACHE_ITERATIONS; it++) {
 #endif
 
 #else
     /* For normal mode of PolyRhythm */
-    while (cache_flag) {
+    while (attack_continue(&cache_flag)) {
 #endif
         for (int i = 0; i < mem_size / sizeof(int); i += CACHE_LINE / 4) {
             /* Read or Write, choose one of them, or both? */
@@ -142,6 +146,9 @@ int cache_attack() {
 
             /* Write attack */
             local_attack_array[i] = 0xff;
+
+            if (!attack_continue_every(&work, CACHE_QUANTUM, &cache_flag))
+                break;
         }
 
         /* Count the cache loop, less count means more cache contention */
@@ -280,8 +287,8 @@ int online_profiling_cache_attack() {
     int tmp_count = 0;  // This variable is used to count
     int last_timing = 0;
     bool ready_to_jump = false;
-    while (cache_flag) {
-        for (i = 0; i < NUM_SLICE; i++) {
+    while (attack_continue(&cache_flag)) {
+        for (i = 0; i < NUM_SLICE && attack_continue(&cache_flag); i++) {
             /* We measure the time for each iteration, less time meams more
              * contention */
             long start = get_current_time_us();
@@ -356,8 +363,8 @@ no_profiling:
     printf("Entering the attack loop \n");
     /* Attack loop */
     /* With less if else predicate, this attack loop is more effective */
-    while (cache_flag) {
-        for (i = 0; i < NUM_SLICE; i++) {
+    while (attack_continue(&cache_flag)) {
+        for (i = 0; i < NUM_SLICE && attack_continue(&cache_flag); i++) {
             for (j = 0; j < (mem_size / NUM_SLICE) / sizeof(int);
                  j += CACHE_LINE / 4) {
                 /* Read or Write, choose one of them, or both? */
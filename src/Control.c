@@ -0,0 +1,151 @@
+#include "Control.h"
+
+#include <linux/futex.h>
+#include <stdio.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "Burst.h"
+#include "Utils.h"
+
+__thread attack_ctl_t *attack_self;
+
+static attack_ctl_t ctls[CTL_MAX_THREADS];
+static int num_ctls;
+static int stopping;
+
+/* Control block of this thread, kept across primitives (RL switches) */
+static __thread attack_ctl_t *own_ctl;
+
+/**
+ * @brief Record the latency of the posted command and apply it
+ * @return 0 if the thread must return from its primitive
+ */
+int ctl_acknowledge(attack_ctl_t *ctl) {
+    uint64_t word = __atomic_load_n(&ctl->word, __ATOMIC_ACQUIRE);
+    uint64_t posted = __atomic_load_n(&ctl->posted_ns, __ATOMIC_RELAXED);
+    uint64_t now = get_current_time_ns();
+    int cmd = (int)(word & CTL_CMD_MASK);
+
+    if (cmd == CTL_STOP) {
+        hist_record(&ctl->stop_latency, now > posted ? now - posted : 0);
+    } else if (cmd == CTL_SWITCH) {
+        hist_record(&ctl->switch_latency, now > posted ? now - posted : 0);
+    }
+
+    __atomic_store_n(&ctl->halted, cmd != CTL_RUN, __ATOMIC_RELAXED);
+    __atomic_store_n(&ctl->seen, word, __ATOMIC_RELEASE);
+    return cmd == CTL_RUN;
+}
+
+/**
+ * @brief Attach the calling thread's control block, allocated on first use
+ * @return NULL when all CTL_MAX_THREADS blocks are taken; the thread then
+ * only follows the loop flag of its primitive
+ */
+attack_ctl_t *ctl_enter(attack_channel_t channel) {
+    attack_ctl_t *ctl = own_ctl;
+
+    if (ctl == NULL) {
+        int index = __atomic_fetch_add(&num_ctls, 1, __ATOMIC_ACQ_REL);
+
+        if (index >= CTL_MAX_THREADS) return NULL;
+        ctl = own_ctl = &ctls[index];
+        hist_reset(&ctl->stop_latency);
+        hist_reset(&ctl->switch_latency);
+        hist_reset(&ctl->burst_lateness);
+        hist_reset(&ctl->burst_overrun);
+    }
+
+    /* Commands posted while the thread was idle do not apply. Publishing
+     * active before reading stopping pairs with ctl_stop_all(): either the
+     * stop is posted to this block, or it is seen here. */
+    ctl->channel = channel;
+    __atomic_store_n(&ctl->seen, __atomic_load_n(&ctl->word, __ATOMIC_ACQUIRE),
+                     __ATOMIC_RELEASE);
+    __atomic_store_n(&ctl->active, 1, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&ctl->halted, __atomic_load_n(&stopping, __ATOMIC_SEQ_CST),
+                     __ATOMIC_RELAXED);
+    burst_enter(ctl);
+    attack_self = ctl;
+    return ctl;
+}
+
+/**
+ * @brief Detach the control block, acknowledging a command the primitive
+ * returned on without checking it (e.g. its loop flag was seen first)
+ */
+void ctl_leave(void) {
+    attack_ctl_t *ctl = attack_self;
+
+    if (ctl == NULL) return;
+    if (__atomic_load_n(&ctl->word, __ATOMIC_ACQUIRE) != ctl->seen)
+        ctl_acknowledge(ctl);
+    burst_leave(ctl);
+    __atomic_store_n(&ctl->active, 0, __ATOMIC_RELEASE);
+    attack_self = NULL;
+}
+
+void ctl_post(attack_ctl_t *ctl, int cmd) {
+    uint64_t word = __atomic_load_n(&ctl->word, __ATOMIC_RELAXED), next;
+
+    __atomic_store_n(&ctl->posted_ns, get_current_time_ns(), __ATOMIC_RELAXED);
+    do {
+        next = ((word >> CTL_CMD_BITS) + 1) << CTL_CMD_BITS | (uint64_t)cmd;
+    } while (!__atomic_compare_exchange_n(&ctl->word, &word, next, 0,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+    /* Wake the thread if it is parked between two bursts */
+    ctl_kick(ctl);
+}
+
+void ctl_kick(attack_ctl_t *ctl) {
+    __atomic_fetch_add(&ctl->wake, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &ctl->wake, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+void ctl_stop_all(void) {
+    int i, count;
+
+    __atomic_store_n(&stopping, 1, __ATOMIC_SEQ_CST);
+    count = ctl_count();
+    for (i = 0; i < count; i++) {
+        if (__atomic_load_n(&ctls[i].active, __ATOMIC_SEQ_CST))
+            ctl_post(&ctls[i], CTL_STOP);
+    }
+}
+
+int ctl_stopping(void) { return __atomic_load_n(&stopping, __ATOMIC_ACQUIRE); }
+
+int ctl_busy(attack_ctl_t *ctl) {
+    return __atomic_load_n(&ctl->active, __ATOMIC_ACQUIRE) &&
+           __atomic_load_n(&ctl->word, __ATOMIC_ACQUIRE) ==
+               __atomic_load_n(&ctl->seen, __ATOMIC_ACQUIRE) &&
+           !__atomic_load_n(&ctl->halted, __ATOMIC_RELAXED);
+}
+
+int ctl_count(void) {
+    return MIN(__atomic_load_n(&num_ctls, __ATOMIC_ACQUIRE), CTL_MAX_THREADS);
+}
+
+attack_ctl_t *ctl_at(int index) {
+    if (index < 0 || index >= ctl_count()) return NULL;
+    return &ctls[index];
+}
+
+void ctl_print_latency(void) {
+    latency_hist_t stop, sw;
+    int i, count = ctl_count();
+
+    hist_reset(&stop);
+    hist_reset(&sw);
+    for (i = 0; i < count; i++) {
+        /* A block is zero until its thread reset the histograms */
+        if (ctls[i].stop_latency.count) hist_merge(&stop, &ctls[i].stop_latency);
+        if (ctls[i].switch_latency.count)
+            hist_merge(&sw, &ctls[i].switch_latency);
+    }
+    if (stop.count) hist_print(&stop, "Stop latency");
+    if (sw.count) hist_print(&sw, "Switch latency");
+    if (burst_enabled()) burst_print();
+}
@@ -0,0 +1,226 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Attacks.h"
+#include "Control.h"
+#include "PolyRhythm.h"
+#include "Utils.h"
+
+/* Extern trigger flags
+ * To stop attack primitives
+ */
+extern int dev_flag;
+
+/*************************************
+ * Device attack
+ * Generates kernel copy and VFS load through the memory character
+ * devices, without touching any disk:
+ *  - large reads from /dev/zero (clear_user into our buffer)
+ *  - large reads from /dev/urandom (ChaCha20 generation, then copy)
+ *  - large writes to /dev/null (VFS path only, nothing is copied)
+ *  - shared mappings of /dev/zero (a shmem object per mapping, faulted
+ *    page by page, then torn down)
+ * Each attack thread cycles through the selected operations.
+ * ***********************************
+ */
+
+#define DEV_MAX_BLOCK_SIZE (64 * MB)
+#define DEV_REPORT_INTERVAL_US 1000000  // Print rates once per second
+
+enum dev_op {
+    dev_zero_read = 0,
+    dev_urandom_read,
+    dev_null_write,
+    dev_zero_mmap,
+    dev_num_ops
+};
+
+static const char *dev_op_names[dev_num_ops] = {"zero read", "urandom read",
+                                                "null write", "zero mmap"};
+
+/* Global variables */
+static int dev_ops;  // Bit mask of enum dev_op
+static size_t block_size;
+static uint64_t op_interval_ns;  // Per operation, 0: unthrottled
+
+static int next_thread_index;
+
+static unsigned long total_bytes[dev_num_ops];
+static unsigned long run_bytes[dev_num_ops];  // Since the start, for stats
+
+/**
+ * @brief Initialize the device attack channels
+ * @param:
+ * 0: operations, as a bit mask, 1: /dev/zero reads, 2: /dev/urandom
+ *    reads, 4: /dev/null writes, 8: /dev/zero mappings (0: all of them)
+ * 1: block size, in bytes (the size of the mappings)
+ * 2: operations per second per attack thread (0: as fast as possible)
+ * 3: unused
+ */
+int init_dev_attack(void *arguments) {
+    int *args = (int *)arguments;
+
+    dev_ops = args[0] ? args[0] : (1 << dev_num_ops) - 1;
+    if (dev_ops < 0 || dev_ops >= (1 << dev_num_ops)) {
+        printf("Dev Attack: unknown operations 0x%x \n", args[0]);
+        return EXIT_FAILURE;
+    }
+    if (args[1] <= 0 || args[1] > DEV_MAX_BLOCK_SIZE || args[2] < 0) {
+        printf("Dev Attack: invalid block size %d or rate %d \n", args[1],
+               args[2]);
+        return EXIT_FAILURE;
+    }
+
+    block_size = args[1];
+    op_interval_ns = args[2] ? NANOSEC / args[2] : 0;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Map a block of /dev/zero, fault every page in, unmap it
+ */
+static ssize_t map_zero(int fd) {
+    volatile char *addr;
+    size_t off;
+
+    addr = mmap(NULL, block_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) return -1;
+    for (off = 0; off < block_size; off += PAGE_SIZE) addr[off] = 1;
+    munmap((void *)addr, block_size);
+    return block_size;
+}
+
+/**
+ * @brief Main device attack loop.
+ */
+int dev_attack() {
+    static const char *paths[dev_num_ops] = {"/dev/zero", "/dev/urandom",
+                                             "/dev/null", "/dev/zero"};
+    static const int modes[dev_num_ops] = {O_RDONLY, O_RDONLY, O_WRONLY,
+                                           O_RDWR};
+    int fds[dev_num_ops];
+    unsigned long bytes[dev_num_ops] = {0};
+    uint64_t deadline = get_current_time_ns();
+    long last_report = get_current_time_us();
+    char *buf;
+    int index, op, i, status = EXIT_SUCCESS;
+    ssize_t ret;
+
+    index = __atomic_fetch_add(&next_thread_index, 1, __ATOMIC_RELAXED);
+    for (i = 0; i < dev_num_ops; i++) fds[i] = -1;
+
+    buf = malloc(block_size);
+    if (buf == NULL) {
+        printf("Dev Attack: cannot allocate %zu bytes: %s \n", block_size,
+               strerror(errno));
+        status = EXIT_FAILURE;
+        goto out_free;
+    }
+    memset(buf, 0x5a, block_size);
+
+    for (i = 0; i < dev_num_ops; i++) {
+        if (!(dev_ops & (1 << i))) continue;
+        fds[i] = open(paths[i], modes[i]);
+        if (fds[i] < 0) {
+            printf("Dev Attack: cannot open %s: %s \n", paths[i],
+                   strerror(errno));
+            status = EXIT_FAILURE;
+            goto out_free;
+        }
+    }
+
+    /* Threads start on different operations, to spread the load */
+    op = index % dev_num_ops;
+    while (attack_continue(&dev_flag)) {
+        while (!(dev_ops & (1 << op))) op = (op + 1) % dev_num_ops;
+
+        uint64_t start = get_current_time_ns();
+        switch (op) {
+            case dev_zero_read:
+            case dev_urandom_read:
+                ret = read(fds[op], buf, block_size);
+                break;
+            case dev_null_write:
+                ret = write(fds[op], buf, block_size);
+                break;
+            default:
+                ret = map_zero(fds[op]);
+                break;
+        }
+        if (ret > 0) bytes[op] += ret;
+        op = (op + 1) % dev_num_ops;
+
+        if (op_interval_ns) {
+            deadline += op_interval_ns;
+            if (deadline > start) {
+                struct timespec ts = {.tv_sec = deadline / NANOSEC,
+                                      .tv_nsec = deadline % NANOSEC};
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+            } else if (start - deadline > NANOSEC) {
+                deadline = start;
+            }
+        }
+
+        long now = get_current_time_us();
+        if (now - last_report >= DEV_REPORT_INTERVAL_US) {
+            for (i = 0; i < dev_num_ops; i++) {
+                __atomic_fetch_add(&total_bytes[i], bytes[i],
+                                   __ATOMIC_RELAXED);
+                __atomic_fetch_add(&run_bytes[i], bytes[i], __ATOMIC_RELAXED);
+                bytes[i] = 0;
+            }
+
+            /* The first attack thread reports for all of them */
+            if (index == 0) {
+                double secs = (double)(now - last_report) / MICROSEC;
+
+                printf("[Dev] MB/s over %d threads:",
+                       __atomic_load_n(&next_thread_index, __ATOMIC_RELAXED));
+                for (i = 0; i < dev_num_ops; i++) {
+                    if (!(dev_ops & (1 << i))) continue;
+                    printf(" %s %.1f", dev_op_names[i],
+                           __atomic_exchange_n(&total_bytes[i], 0,
+                                               __ATOMIC_RELAXED) /
+                               secs / MB);
+                }
+                printf("\n");
+            }
+            last_report = now;
+        }
+    }
+
+    for (i = 0; i < dev_num_ops; i++)
+        __atomic_fetch_add(&run_bytes[i], bytes[i], __ATOMIC_RELAXED);
+
+out_free:
+    for (i = 0; i < dev_num_ops; i++) {
+        if (fds[i] >= 0) close(fds[i]);
+    }
+    free(buf);
+    return status;
+}
+
+/**
+ * @brief Print the bytes moved by every operation since the start
+ */
+void dev_attack_stats(double secs) {
+    double per_sec = secs > 0 ? 1 / secs : 0;
+    int i;
+
+    printf("[Dev] total over %.1f s:", secs);
+    for (i = 0; i < dev_num_ops; i++) {
+        if (!(dev_ops & (1 << i))) continue;
+        printf(" %s %.1f MB (%.1f MB/s)", dev_op_names[i],
+               (double)run_bytes[i] / MB, run_bytes[i] * per_sec / MB);
+    }
+    printf("\n");
+}
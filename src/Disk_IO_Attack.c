@@ -1,12 +1,16 @@
-
+#define _GNU_SOURCE
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <time.h>
 
 #include "Attacks.h"
+#include "Control.h"
 #include "PolyRhythm.h"
 #include "Utils.h"
 
@@ -17,7 +21,6 @@
  * To stop attack primitives
  */
 extern int disk_flag;
-extern struct action *shared_memory_action;
 
 /**************************************************************
  * Parameters for fadvise disk io attack (only for Linux) *****
@@ -29,6 +32,29 @@ extern struct action *shared_memory_action;
 /* Two access pattern */
 enum io_pattern { pattern_sequential = 0, pattern_random };
 
+/* The mode parameter: access pattern in bit 0, plus flags */
+#define DISK_PATTERN_MASK 0x1
+#define DISK_DIRECT_IO 0x2
+#define DISK_ROUND_ROBIN 0x4
+/* Bits 4-7 select the durability policy, bits 8+ the sync interval */
+#define DISK_SYNC_SHIFT 4
+#define DISK_SYNC_MASK 0xf
+#define DISK_SYNC_INTERVAL_SHIFT 8
+
+/* How writes are made durable */
+enum sync_policy {
+    sync_fsync = 0,      // fsync(), data + metadata + journal commit
+    sync_none,           // leave it to background writeback
+    sync_fdatasync,      // fdatasync(), skips metadata-only updates
+    sync_range_write,    // sync_file_range() to start writeback, no wait
+    sync_range_wait,     // sync_file_range() to write and wait for the range
+    sync_o_dsync,        // open with O_DSYNC, every write is synchronous
+    sync_num_policies
+};
+
+/* Used when the device does not tell its logical block size */
+#define DEFAULT_LOGICAL_BLOCK_SIZE 4096
+
 extern unsigned long int diskio_contention_count;
 
 /* Global variables */
@@ -37,95 +63,372 @@ static int num_pages;
 static int disk_content_size;
 static int stride;
 static enum io_pattern adivse;
+static int direct_io;
+static int block_size = 1;  // Offset alignment, only > 1 with O_DIRECT
+static enum sync_policy sync_policy;
+static int sync_interval;  // Sync once every sync_interval writes
 
-static char *filename;
 static char *content;
-static int filesize;
-static int fd;  // File descriptor
+static off_t filesize;
+static int open_flags;
+
+/* Spread the I/O over several files, directories or mount points */
+#define DISK_PATHS_ENV "POLYRHYTHM_DISK_PATHS"
+#define MAX_DISK_TARGETS 32
+#define DISK_REPORT_INTERVAL_US 1000000  // Print throughput once per second
+
+struct disk_target {
+    int fd;  // File descriptor
+    dev_t dev;
+    char path[PATH_MAX];
+};
+
+static struct disk_target targets[MAX_DISK_TARGETS];
+static int num_targets;
+static int round_robin;  // Switch target on every write instead of per thread
+static int next_thread_index;
+
+/* Per-device counters, sampled from /proc/diskstats */
+struct disk_device {
+    dev_t dev;
+    char name[32];
+    unsigned long long reads, read_sectors, writes, write_sectors;
+};
+
+static struct disk_device devices[MAX_DISK_TARGETS];
+static struct disk_device devices_start[MAX_DISK_TARGETS];  // At init
+static int num_devices;
+
+static unsigned long run_writes;  // Since the start, for stats
+
+/**
+ * @brief Logical block size of the device backing a file.
+ * O_DIRECT requires buffers, sizes and offsets aligned to it.
+ * Partitions have no queue directory of their own, so we also look at
+ * the parent disk.
+ */
+int get_logical_block_size(int file) {
+    const char *formats[] = {"/sys/dev/block/%u:%u/queue/logical_block_size",
+                             "/sys/dev/block/%u:%u/../queue/logical_block_size"};
+    struct stat st;
+    char path[128];
+    int size, i;
+
+    if (fstat(file, &st)) return DEFAULT_LOGICAL_BLOCK_SIZE;
+
+    for (i = 0; i < 2; i++) {
+        FILE *f;
+
+        snprintf(path, sizeof(path), formats[i], major(st.st_dev),
+                 minor(st.st_dev));
+        f = fopen(path, "r");
+        if (!f) continue;
+        if (fscanf(f, "%d", &size) != 1) size = 0;
+        fclose(f);
+        if (size > 0) return size;
+    }
+
+    return DEFAULT_LOGICAL_BLOCK_SIZE;
+}
+
+/**
+ * @brief Read the counters of one device from /proc/diskstats
+ * @return: 0 on success, -1 if the device is not listed
+ */
+static int read_diskstats(struct disk_device *d) {
+    char line[256];
+    FILE *f = fopen("/proc/diskstats", "r");
+    int found = -1;
+
+    if (!f) return -1;
+
+    while (fgets(line, sizeof(line), f)) {
+        unsigned int maj, min;
+        struct disk_device tmp;
+
+        /* major minor name reads merged sectors ms writes merged sectors */
+        if (sscanf(line, "%u %u %31s %llu %*u %llu %*u %llu %*u %llu", &maj,
+                   &min, tmp.name, &tmp.reads, &tmp.read_sectors, &tmp.writes,
+                   &tmp.write_sectors) != 7)
+            continue;
+
+        if (makedev(maj, min) == d->dev) {
+            memcpy(d->name, tmp.name, sizeof(d->name));
+            d->reads = tmp.reads;
+            d->read_sectors = tmp.read_sectors;
+            d->writes = tmp.writes;
+            d->write_sectors = tmp.write_sectors;
+            found = 0;
+            break;
+        }
+    }
+
+    fclose(f);
+    return found;
+}
+
+/**
+ * @brief Print per-device throughput since the last call.
+ * Sectors in /proc/diskstats are always 512 Bytes.
+ */
+static void report_devices(long elapsed_us) {
+    int i;
+
+    for (i = 0; i < num_devices; i++) {
+        struct disk_device now = devices[i];
+
+        if (read_diskstats(&now)) continue;
+
+        printf("[Disk IO] %s: write %.2f MB/s (%.0f IOPS), read %.2f MB/s \n",
+               now.name,
+               (now.write_sectors - devices[i].write_sectors) * 512.0 /
+                   elapsed_us,
+               (now.writes - devices[i].writes) * (double)MICROSEC /
+                   elapsed_us,
+               (now.read_sectors - devices[i].read_sectors) * 512.0 /
+                   elapsed_us);
+        devices[i] = now;
+    }
+}
+
+/**
+ * @brief Open one target and prepare it for the attack
+ * @path: a directory (a file with a random name is created in it) or a
+ * regular file (used as is)
+ */
+static int open_disk_target(const char *path, struct disk_target *t) {
+    struct stat st;
+    char name[20];
+    int i;
+
+    if (stat(path, &st)) {
+        printf("Disk IO Attack: cannot access %s, errno=%d (%s)\n", path,
+               errno, strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    if (S_ISDIR(st.st_mode)) {
+        rand_str(name, sizeof(name) - 1);  // 20 is fixed length of file name
+        snprintf(t->path, sizeof(t->path), "%s/%s", path, name);
+    } else if (S_ISREG(st.st_mode)) {
+        snprintf(t->path, sizeof(t->path), "%s", path);
+    } else {
+        /* Never write to raw block devices, that destroys file systems */
+        printf("Disk IO Attack: %s is not a directory or regular file \n",
+               path);
+        return EXIT_FAILURE;
+    }
+
+    t->fd = open(t->path, open_flags, S_IRUSR | S_IWUSR);
+    if (t->fd < 0 && (open_flags & O_DIRECT)) {
+        /* e.g. tmpfs does not support O_DIRECT */
+        printf("Disk IO Attack: O_DIRECT unsupported on %s, using page "
+               "cache\n",
+               path);
+        t->fd = open(t->path, open_flags & ~O_DIRECT, S_IRUSR | S_IWUSR);
+    }
+    if (t->fd < 0) {
+        printf("Disk IO Attack failed to open file, errno=%d (%s)\n", errno,
+               strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    if (fstat(t->fd, &st) == 0) t->dev = st.st_dev;
+
+    /* With O_DIRECT, writes and offsets must be whole logical blocks */
+    if (direct_io) {
+        block_size = MAX(block_size, get_logical_block_size(t->fd));
+    }
+
+    /* Preallocate the whole file, so writes do not allocate extents */
+    if (fallocate(t->fd, 0, 0, filesize)) {
+        printf("Disk IO Attack failed to preallocate file, errno=%d (%s)\n",
+               errno, strerror(errno));
+    }
+
+    // Set page cache advice, POSIX_FADV_RANDOM is probably best
+    if (posix_fadvise(t->fd, 0, 0, POSIX_FADV_RANDOM)) {
+        printf("Disk IO Attack failed to set fadvise, errno=%d (%s)\n", errno,
+               strerror(errno));
+    }
+
+    /* Track each device once for the throughput report */
+    for (i = 0; i < num_devices; i++) {
+        if (devices[i].dev == t->dev) break;
+    }
+    if (i == num_devices) {
+        devices[num_devices].dev = t->dev;
+        if (read_diskstats(&devices[num_devices]) == 0) {
+            devices_start[num_devices] = devices[num_devices];
+            num_devices++;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
 
 /**
  * @brief Initialize disk I/O attack channels
+ * Targets are taken from the colon-separated list in the
+ * POLYRHYTHM_DISK_PATHS environment variable, or the current directory.
  * @param:
  * 0: number of pages
  * 1: content size for each write operation
  * 2: stride to jump for each write operation
+ * 3: mode, access pattern (0: sequential, 1: random) + 2 for O_DIRECT
+ *    + 4 for round-robin over targets + 16 * sync policy
+ *    + 256 * sync interval
  */
 int init_advise_disk_io_attack(void *arguments) {
     int *args = (int *)arguments;
-    int posix_advise_pattern = POSIX_FADV_RANDOM;
+    const char *env_paths = getenv(DISK_PATHS_ENV);
+    char *paths, *path, *saveptr;
+
     num_pages = args[0];  // pages
     disk_content_size = args[1];
     stride = args[2];
-    adivse = args[3];
+    adivse = args[3] & DISK_PATTERN_MASK;
+    direct_io = args[3] & DISK_DIRECT_IO;
+    round_robin = args[3] & DISK_ROUND_ROBIN;
+    sync_policy = (args[3] >> DISK_SYNC_SHIFT) & DISK_SYNC_MASK;
+    sync_interval = args[3] >> DISK_SYNC_INTERVAL_SHIFT;
+    if (sync_interval <= 0) sync_interval = 1;
+
+    if (sync_policy >= sync_num_policies) {
+        printf("Disk IO Attack: unknown sync policy %d \n", sync_policy);
+        return EXIT_FAILURE;
+    }
 
     // Set file size
-    filesize = num_pages * PAGE_SIZE;
-
-    /* Construct file name */
-    filename = malloc(sizeof(char) * 20);  // 20 is fixed length of file name
-    rand_str(filename, 19);
+    filesize = (off_t)num_pages * PAGE_SIZE;
+
+    // Create and open the files
+    open_flags = O_RDWR | O_CREAT;
+    if (direct_io) open_flags |= O_DIRECT;
+    if (sync_policy == sync_o_dsync) open_flags |= O_DSYNC;
+
+    paths = strdup(env_paths && *env_paths ? env_paths : ".");
+    num_targets = 0;
+    for (path = strtok_r(paths, ":", &saveptr); path;
+         path = strtok_r(NULL, ":", &saveptr)) {
+        if (num_targets == MAX_DISK_TARGETS) {
+            printf("Disk IO Attack: only the first %d targets are used \n",
+                   MAX_DISK_TARGETS);
+            break;
+        }
+        if (open_disk_target(path, &targets[num_targets]) == EXIT_SUCCESS)
+            num_targets++;
+    }
+    free(paths);
 
-    /* Construct the content to be wrote */
-    content = malloc(sizeof(char) * disk_content_size);
-    /* Fill the packet with data */
-    rand_str(content, disk_content_size);
-
-    // Convert to posix pattern
-    // posix_advise_pattern = adivse + 1;
-    // Create and open file
-    fd = -1;
-    while (fd < 0) {
-        fd = open(filename, O_RDWR | O_CREAT);
-        if (fd < 0)
-            printf("Disk IO Attack failed to open file, errno=%d (%s)\n", errno,
-                   strerror(errno));
+    if (num_targets == 0) {
+        printf("Disk IO Attack: no usable target \n");
         return EXIT_FAILURE;
     }
 
-    // Set page cache advice, POSIX_FADV_RANDOM is probably best
+    if (direct_io) {
+        disk_content_size =
+            (disk_content_size + block_size - 1) / block_size * block_size;
+        stride = (stride + block_size - 1) / block_size * block_size;
+    }
 
-    if (posix_fadvise(
-            fd, 0, 0,
-            posix_advise_pattern)) {  // Currently set to POSIX_FADV_RANDOM
-        printf("Disk IO Attack failed to set fadvise, errno=%d (%s)\n", errno,
-               strerror(errno));
+    if (disk_content_size <= 0 || filesize <= disk_content_size) {
+        printf("Disk IO Attack: file must be larger than one write \n");
         return EXIT_FAILURE;
     }
 
+    /* Construct the content to be wrote, aligned for O_DIRECT */
+    if (posix_memalign((void **)&content, PAGE_SIZE, disk_content_size)) {
+        printf("Disk IO Attack failed to allocate write buffer \n");
+        return EXIT_FAILURE;
+    }
+    /* Fill the packet with data */
+    rand_str(content, disk_content_size - 1);
+
     return EXIT_SUCCESS;
 }
 
+/**
+ * @brief Apply the durability policy after a write
+ * @fd: file that was written
+ * @offset: offset of the last write
+ * @writes: number of writes so far
+ */
+static int disk_sync(int fd, off_t offset, unsigned long writes) {
+    off_t start = offset, len = disk_content_size;
+
+    if (writes % sync_interval) return 0;
+
+    /* A batch may span the whole file */
+    if (sync_interval > 1) start = len = 0;
+
+    switch (sync_policy) {
+        case sync_fsync:
+            return fsync(fd);
+        case sync_fdatasync:
+            return fdatasync(fd);
+        case sync_range_write:
+            return sync_file_range(fd, start, len, SYNC_FILE_RANGE_WRITE);
+        case sync_range_wait:
+            return sync_file_range(fd, start, len,
+                                   SYNC_FILE_RANGE_WAIT_BEFORE |
+                                       SYNC_FILE_RANGE_WRITE |
+                                       SYNC_FILE_RANGE_WAIT_AFTER);
+        default:  // sync_none, sync_o_dsync
+            return 0;
+    }
+}
+
 /**
  * @brief Main disk I/O attack loop.
  */
 int advise_disk_io_attack() {
+    /* Each thread keeps its target, RL mode re-enters this function */
+    static __thread int thread_index = -1;
+    static long last_report;
+    int target;
+
     // Track file offset
-    int offset = 0;
+    off_t offset = 0;
+    unsigned long writes = 0;
+
+    if (num_targets == 0) return EXIT_FAILURE;
+
+    if (thread_index < 0) {
+        thread_index =
+            __atomic_fetch_add(&next_thread_index, 1, __ATOMIC_RELAXED);
+    }
+    target = thread_index % num_targets;
+    if (thread_index == 0 && last_report == 0) {
+        last_report = get_current_time_us();
+    }
 
     /* Execute attack loop */
 
 #ifdef RL_ONLINE
 
 #ifdef TIMER
-    while (shared_memory_action->disk) {
+    while (attack_continue(&disk_flag)) {
 #else
     for (int it = 0; it < DISK_ITERATIONS; it++) {
 #endif
 
 #else
     /* For normal mode of PolyRhythm */
-    while (disk_flag) {
+    while (attack_continue(&disk_flag)) {
 #endif
 
+        int fd = targets[target].fd;
+
         // Write to file
-        if (write(fd, content, disk_content_size) < 0) {
+        if (pwrite(fd, content, disk_content_size, offset) < 0) {
             printf("Disk IO Attack failed to write to file, errno=%d (%s)\n",
                    errno, strerror(errno));
             return EXIT_FAILURE;
         }
 
         // Flush writeback buffer
-        if (fsync(fd)) {
+        if (disk_sync(fd, offset, ++writes)) {
             printf(
                 "Disk IO Attack failed to flush writeback buffer, errno=%d "
                 "(%s)\n",
@@ -133,19 +436,25 @@ int advise_disk_io_attack() {
             return EXIT_FAILURE;
         }
 
-        // Seek in file, use filesize-size to keep from writing past end
+        // Next offset, use filesize-size to keep from writing past end
         if (adivse == pattern_sequential) {
             offset = (offset + stride) % (filesize - disk_content_size);
         } else if (adivse == pattern_random) {
             offset = rand() % (filesize - disk_content_size);
         }
 
-        if (lseek(fd, offset, SEEK_SET) < 0) {
-            printf(
-                "Disk IO Attack failed to flush writeback buffer, errno=%d "
-                "(%s)\n",
-                errno, strerror(errno));
-            return EXIT_FAILURE;
+        // Round down to the logical block for O_DIRECT
+        offset -= offset % block_size;
+
+        if (round_robin) target = (target + 1) % num_targets;
+
+        /* The first thread reports for the whole process */
+        if (thread_index == 0 && num_devices > 0) {
+            long now = get_current_time_us();
+            if (now - last_report >= DISK_REPORT_INTERVAL_US) {
+                report_devices(now - last_report);
+                last_report = now;
+            }
         }
 
         /* Count the disk I/O loop, less count means more cache contention */
@@ -153,6 +462,8 @@ int advise_disk_io_attack() {
 
     }  // End of attack loop
 
+    __atomic_fetch_add(&run_writes, writes, __ATOMIC_RELAXED);
+
     // In normal mode, PolyRhythm will not reach here
     // This is for RL, we back to sched_next_tasks() to execute the next action
     // sched_next_tasks();
@@ -162,3 +473,28 @@ int advise_disk_io_attack() {
 
     return 0;
 }
+
+/**
+ * @brief Print the writes of the attack, and the traffic of the devices,
+ * since the start
+ */
+void advise_disk_io_attack_stats(double secs) {
+    double per_sec = secs > 0 ? 1 / secs : 0;
+    int i;
+
+    printf("[Disk IO] total over %.1f s: %lu writes (%.0f/s), %.1f MB \n",
+           secs, run_writes, run_writes * per_sec,
+           (double)run_writes * disk_content_size / MB);
+    for (i = 0; i < num_devices; i++) {
+        struct disk_device now = devices_start[i];
+
+        if (read_diskstats(&now)) continue;
+        printf("[Disk IO] %s since init: write %.1f MB (%llu IOs), read "
+               "%.1f MB \n",
+               now.name,
+               (now.write_sectors - devices_start[i].write_sectors) * 512.0 /
+                   MB,
+               now.writes - devices_start[i].writes,
+               (now.read_sectors - devices_start[i].read_sectors) * 512.0 / MB);
+    }
+}
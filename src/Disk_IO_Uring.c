@@ -0,0 +1,511 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <time.h>
+
+#include "Attacks.h"
+#include "Control.h"
+#include "Histogram.h"
+#include "PolyRhythm.h"
+#include "Utils.h"
+
+/* The C library may not wrap io_uring, we use the raw system calls */
+#if defined(__NR_io_uring_setup) && __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define HAVE_IO_URING 1
+#endif
+
+/* Extern trigger flags
+ * To stop attack primitives
+ */
+extern int uring_flag;
+
+extern unsigned long int diskio_contention_count;
+
+/**************************************************************
+ * Parameters for io_uring disk io attack (only for Linux) ****
+ * The synchronous disk attack never has more than one request in
+ * flight. This engine keeps a configurable number of requests queued,
+ * so the block layer request queues actually fill up.
+ * *********************************************************************
+ */
+
+#define URING_MAX_QUEUE_DEPTH 4096
+#define URING_DEFAULT_BLOCK_SIZE (4 * KB)
+#define URING_REPORT_INTERVAL_US 1000000  // Print IOPS once per second
+
+/* The mode parameter: read percentage in the low byte, plus flags */
+#define URING_READ_PCT_MASK 0xff
+#define URING_REGISTERED_BUFFERS 0x100
+#define URING_SQPOLL 0x200
+#define URING_DIRECT_IO 0x400
+
+/* Global variables */
+static int num_pages;
+static int block_size;
+static int queue_depth;
+static int read_pct;
+static int uring_mode;
+
+static off_t filesize;
+static int fd = -1;  // File descriptor shared by all rings
+
+/* Totals of all threads since the start, for stats */
+static pthread_mutex_t run_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long run_reads, run_writes;
+static latency_hist_t run_hist;
+
+/**
+ * @brief Initialize io_uring disk I/O attack channels
+ * @param:
+ * 0: number of pages of the target file
+ * 1: block size of each request, in Bytes
+ * 2: queue depth (requests in flight per attack thread)
+ * 3: mode, read percentage (0-100) + 256 for registered buffers
+ *    + 512 for IORING_SETUP_SQPOLL + 1024 for O_DIRECT
+ */
+int init_uring_disk_io_attack(void *arguments) {
+    int *args = (int *)arguments;
+    char filename[20];
+    char *buffer;
+    off_t written;
+
+    num_pages = args[0];
+    block_size = args[1] > 0 ? args[1] : URING_DEFAULT_BLOCK_SIZE;
+    queue_depth = args[2];
+    uring_mode = args[3];
+    read_pct = MIN(uring_mode & URING_READ_PCT_MASK, 100);
+
+    filesize = (off_t)num_pages * PAGE_SIZE;
+
+    if (queue_depth <= 0 || queue_depth > URING_MAX_QUEUE_DEPTH) {
+        printf("Disk uring Attack: queue depth must be within 1-%d \n",
+               URING_MAX_QUEUE_DEPTH);
+        return EXIT_FAILURE;
+    }
+
+    /* Create and fill the file, reads of holes would never reach the disk */
+    rand_str(filename, sizeof(filename) - 1);
+    fd = open(filename, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        printf("Disk uring Attack failed to open file, errno=%d (%s)\n",
+               errno, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    /* The file goes away with the process */
+    unlink(filename);
+
+    /* O_DIRECT needs requests of whole logical blocks */
+    if (uring_mode & URING_DIRECT_IO) {
+        int lbs = get_logical_block_size(fd);
+
+        if (block_size % lbs) {
+            block_size = (block_size + lbs - 1) / lbs * lbs;
+            printf("Disk uring Attack: block size rounded up to %d \n",
+                   block_size);
+        }
+    }
+
+    if (filesize < block_size) {
+        printf("Disk uring Attack: file smaller than one block \n");
+        goto fail;
+    }
+
+    buffer = malloc(block_size);
+    if (buffer == NULL) {
+        printf("Disk uring Attack: failed to allocate the fill buffer \n");
+        goto fail;
+    }
+    rand_str(buffer, block_size - 1);
+    for (written = 0; written + block_size <= filesize; written += block_size) {
+        if (write(fd, buffer, block_size) != block_size) {
+            printf("Disk uring Attack failed to fill file, errno=%d (%s)\n",
+                   errno, strerror(errno));
+            free(buffer);
+            goto fail;
+        }
+    }
+    free(buffer);
+    (void)fsync(fd);
+
+    if (posix_fadvise(fd, 0, 0, POSIX_FADV_RANDOM)) {
+        printf("Disk uring Attack failed to set fadvise \n");
+    }
+
+    /* Bypass the page cache, requests then land on the device queue */
+    if (uring_mode & URING_DIRECT_IO) {
+        (void)posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+        if (fcntl(fd, F_SETFL, O_DIRECT)) {
+            printf("Disk uring Attack: O_DIRECT unsupported here (%s) \n",
+                   strerror(errno));
+        }
+    }
+
+    hist_reset(&run_hist);
+    return EXIT_SUCCESS;
+
+fail:
+    close(fd);
+    fd = -1;
+    return EXIT_FAILURE;
+}
+
+#ifdef HAVE_IO_URING
+
+/* User-space view of one submission/completion ring pair */
+struct uring {
+    int fd;
+    unsigned setup_flags;
+
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_flags, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_size, cq_ring_size, sqes_size;
+};
+
+static int sys_io_uring_setup(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_io_uring_enter(int ring_fd, unsigned to_submit,
+                              unsigned min_complete, unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete,
+                        flags, NULL, 0);
+}
+
+static int sys_io_uring_register(int ring_fd, unsigned opcode, void *arg,
+                                 unsigned nr_args) {
+    return (int)syscall(__NR_io_uring_register, ring_fd, opcode, arg,
+                        nr_args);
+}
+
+/**
+ * @brief Create a ring and map its submission and completion queues
+ */
+static int uring_setup(struct uring *r, unsigned entries, unsigned flags) {
+    struct io_uring_params p;
+
+    memset(&p, 0, sizeof(p));
+    p.flags = flags;
+
+    r->fd = sys_io_uring_setup(entries, &p);
+    if (r->fd < 0) return -1;
+    r->setup_flags = flags;
+
+    r->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_ring_size =
+        p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    r->sq_ring = mmap(NULL, r->sq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    r->cq_ring = mmap(NULL, r->cq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+    r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+    if (r->sq_ring == MAP_FAILED || r->cq_ring == MAP_FAILED ||
+        r->sqes == MAP_FAILED) {
+        close(r->fd);
+        return -1;
+    }
+
+    r->sq_head = (unsigned *)((char *)r->sq_ring + p.sq_off.head);
+    r->sq_tail = (unsigned *)((char *)r->sq_ring + p.sq_off.tail);
+    r->sq_mask = (unsigned *)((char *)r->sq_ring + p.sq_off.ring_mask);
+    r->sq_flags = (unsigned *)((char *)r->sq_ring + p.sq_off.flags);
+    r->sq_array = (unsigned *)((char *)r->sq_ring + p.sq_off.array);
+
+    r->cq_head = (unsigned *)((char *)r->cq_ring + p.cq_off.head);
+    r->cq_tail = (unsigned *)((char *)r->cq_ring + p.cq_off.tail);
+    r->cq_mask = (unsigned *)((char *)r->cq_ring + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)((char *)r->cq_ring + p.cq_off.cqes);
+
+    return 0;
+}
+
+static void uring_teardown(struct uring *r) {
+    munmap(r->sqes, r->sqes_size);
+    munmap(r->cq_ring, r->cq_ring_size);
+    munmap(r->sq_ring, r->sq_ring_size);
+    close(r->fd);
+}
+
+/**
+ * @brief Queue one read or write for a slot at a random aligned offset
+ * @return: 1 if a read was queued, 0 for a write
+ */
+static int uring_queue(struct uring *r, int slot, struct iovec *iov,
+                       int fixed) {
+    unsigned tail = *r->sq_tail;
+    unsigned index = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[index];
+    int is_read = (rand() % 100) < read_pct;
+    off_t offset = (off_t)(rand() % (filesize / block_size)) * block_size;
+
+    memset(sqe, 0, sizeof(*sqe));
+    if (fixed) {
+        sqe->opcode = is_read ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+        sqe->addr = (unsigned long)iov[slot].iov_base;
+        sqe->len = iov[slot].iov_len;
+        sqe->buf_index = slot;
+    } else {
+        sqe->opcode = is_read ? IORING_OP_READV : IORING_OP_WRITEV;
+        sqe->addr = (unsigned long)&iov[slot];
+        sqe->len = 1;
+    }
+    sqe->flags = IOSQE_FIXED_FILE;
+    sqe->fd = 0;  // Index into the registered file table
+    sqe->off = offset;
+    sqe->user_data = slot;
+
+    r->sq_array[index] = index;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    return is_read;
+}
+
+/**
+ * @brief Wait until every queued request has completed.
+ * The kernel keeps filling the buffers of requests in flight, even after
+ * the ring is unmapped, and O_DIRECT pins their pages.
+ * @return: 0 once all completed, -1 if the ring failed first
+ */
+static int uring_drain(struct uring *r, unsigned inflight) {
+    while (inflight > 0) {
+        unsigned enter_flags = IORING_ENTER_GETEVENTS;
+        unsigned pending, to_submit, head, tail;
+
+        /* Submit what is still queued before waiting on all of it */
+        pending = *r->sq_tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+        to_submit = pending;
+        if (r->setup_flags & IORING_SETUP_SQPOLL) {
+            to_submit = 0;
+            if (__atomic_load_n(r->sq_flags, __ATOMIC_ACQUIRE) &
+                IORING_SQ_NEED_WAKEUP)
+                enter_flags |= IORING_ENTER_SQ_WAKEUP;
+        }
+
+        if (sys_io_uring_enter(r->fd, to_submit, pending ? 0 : inflight,
+                               enter_flags) < 0 &&
+            errno != EINTR && errno != EAGAIN && errno != EBUSY)
+            return -1;
+
+        head = *r->cq_head;
+        tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+        inflight -= tail - head;
+        __atomic_store_n(r->cq_head, tail, __ATOMIC_RELEASE);
+    }
+    return 0;
+}
+
+/**
+ * @brief Add the completions of a thread to the totals
+ */
+static void add_run_totals(unsigned long reads, unsigned long writes,
+                           const latency_hist_t *hist) {
+    pthread_mutex_lock(&run_lock);
+    run_reads += reads;
+    run_writes += writes;
+    hist_merge(&run_hist, hist);
+    pthread_mutex_unlock(&run_lock);
+}
+
+/**
+ * @brief Main io_uring disk I/O attack loop.
+ */
+int uring_disk_io_attack() {
+    struct uring ring;
+    struct iovec *iov;
+    uint64_t *submit_ns;
+    char *slot_is_read;
+    char *buffers;
+    unsigned setup_flags = 0;
+    unsigned to_submit;
+    int fixed = uring_mode & URING_REGISTERED_BUFFERS;
+    int i, ret = EXIT_SUCCESS;
+
+    unsigned long reads = 0, writes = 0;
+    long last_report = get_current_time_us();
+    latency_hist_t hist;
+
+    if (fd < 0) return EXIT_FAILURE;
+
+    /* One buffer per slot, page aligned so it also suits O_DIRECT */
+    if (posix_memalign((void **)&buffers, PAGE_SIZE,
+                       (size_t)block_size * queue_depth)) {
+        printf("Disk uring Attack: failed to allocate buffers \n");
+        return EXIT_FAILURE;
+    }
+    rand_str(buffers, (size_t)block_size * queue_depth - 1);
+
+    iov = malloc(sizeof(struct iovec) * queue_depth);
+    submit_ns = malloc(sizeof(uint64_t) * queue_depth);
+    slot_is_read = malloc(queue_depth);
+    for (i = 0; i < queue_depth; i++) {
+        iov[i].iov_base = buffers + (size_t)i * block_size;
+        iov[i].iov_len = block_size;
+    }
+
+    if (uring_mode & URING_SQPOLL) setup_flags |= IORING_SETUP_SQPOLL;
+
+    if (uring_setup(&ring, queue_depth, setup_flags)) {
+        if (!(setup_flags & IORING_SETUP_SQPOLL)) {
+            printf("Disk uring Attack: io_uring_setup failed, errno=%d (%s)\n",
+                   errno, strerror(errno));
+            ret = EXIT_FAILURE;
+            goto out_free;
+        }
+        /* SQPOLL needs privileges before Linux 5.11 */
+        printf("Disk uring Attack: SQPOLL unavailable (%s), using enter \n",
+               strerror(errno));
+        if (uring_setup(&ring, queue_depth, 0)) {
+            printf("Disk uring Attack: io_uring_setup failed, errno=%d (%s)\n",
+                   errno, strerror(errno));
+            ret = EXIT_FAILURE;
+            goto out_free;
+        }
+    }
+
+    if (sys_io_uring_register(ring.fd, IORING_REGISTER_FILES, &fd, 1)) {
+        printf("Disk uring Attack: failed to register file, errno=%d (%s)\n",
+               errno, strerror(errno));
+        ret = EXIT_FAILURE;
+        goto out_ring;
+    }
+
+    if (fixed && sys_io_uring_register(ring.fd, IORING_REGISTER_BUFFERS, iov,
+                                       queue_depth)) {
+        printf("Disk uring Attack: buffer registration failed (%s) \n",
+               strerror(errno));
+        fixed = 0;
+    }
+
+    /* Fill the queue */
+    hist_reset(&hist);
+    for (i = 0; i < queue_depth; i++) {
+        submit_ns[i] = get_current_time_ns();
+        slot_is_read[i] = uring_queue(&ring, i, iov, fixed);
+    }
+    to_submit = queue_depth;
+
+    while (attack_continue(&uring_flag)) {
+        unsigned enter_flags = IORING_ENTER_GETEVENTS;
+        unsigned head, tail;
+
+        if (ring.setup_flags & IORING_SETUP_SQPOLL) {
+            /* The kernel thread consumes the queue by itself */
+            to_submit = 0;
+            if (__atomic_load_n(ring.sq_flags, __ATOMIC_ACQUIRE) &
+                IORING_SQ_NEED_WAKEUP)
+                enter_flags |= IORING_ENTER_SQ_WAKEUP;
+        }
+
+        if (sys_io_uring_enter(ring.fd, to_submit, 1, enter_flags) < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EBUSY) continue;
+            printf("Disk uring Attack: io_uring_enter failed, errno=%d (%s)\n",
+                   errno, strerror(errno));
+            ret = EXIT_FAILURE;
+            break;
+        }
+        to_submit = 0;
+
+        /* Reap completions and immediately resubmit their slots */
+        head = *ring.cq_head;
+        tail = __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+            int slot = (int)cqe->user_data;
+            uint64_t now = get_current_time_ns();
+
+            if (cqe->res < 0) {
+                printf("Disk uring Attack: request failed (%s)\n",
+                       strerror(-cqe->res));
+                __atomic_store_n(&uring_flag, 0, __ATOMIC_RELAXED);
+                ret = EXIT_FAILURE;
+                break;
+            }
+
+            hist_record(&hist, now - submit_ns[slot]);
+            if (slot_is_read[slot]) {
+                reads++;
+            } else {
+                writes++;
+            }
+
+            /* Count the disk I/O loop, less count means more contention */
+            diskio_contention_count++;
+
+            submit_ns[slot] = now;
+            slot_is_read[slot] = uring_queue(&ring, slot, iov, fixed);
+            to_submit++;
+        }
+        __atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+
+        long now_us = get_current_time_us();
+        if (now_us - last_report >= URING_REPORT_INTERVAL_US) {
+            printf("[Disk uring] %.0f IOPS (read %lu, write %lu), qd %d \n",
+                   (double)(reads + writes) / (now_us - last_report) *
+                       MICROSEC,
+                   reads, writes, queue_depth);
+            hist_print(&hist, "Disk uring latency");
+            add_run_totals(reads, writes, &hist);
+            hist_reset(&hist);
+            reads = writes = 0;
+            last_report = now_us;
+        }
+    }
+
+    add_run_totals(reads, writes, &hist);
+
+    /* Every slot stays queued until reaped, a failed one is still in the
+     * completion queue */
+    if (uring_drain(&ring, queue_depth)) {
+        printf("Disk uring Attack: cannot reap requests in flight, errno=%d "
+               "(%s)\n",
+               errno, strerror(errno));
+        /* Leak the buffers rather than let the kernel write freed memory */
+        buffers = NULL;
+        iov = NULL;
+    }
+
+out_ring:
+    uring_teardown(&ring);
+out_free:
+    free(slot_is_read);
+    free(submit_ns);
+    free(iov);
+    free(buffers);
+    return ret;
+}
+
+#else /* !HAVE_IO_URING */
+
+int uring_disk_io_attack() {
+    printf("Disk uring Attack: io_uring is not supported on this platform \n");
+    return EXIT_FAILURE;
+}
+
+#endif
+
+/**
+ * @brief Print the completions and their latency since the start
+ */
+void uring_disk_io_attack_stats(double secs) {
+    pthread_mutex_lock(&run_lock);
+    printf("[Disk uring] total over %.1f s: %.0f IOPS (read %lu, write %lu) "
+           "\n",
+           secs, secs > 0 ? (run_reads + run_writes) / secs : 0, run_reads,
+           run_writes);
+    hist_print(&run_hist, "Disk uring latency, total");
+    pthread_mutex_unlock(&run_lock);
+}
@@ -0,0 +1,291 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Attacks.h"
+#include "Control.h"
+#include "Histogram.h"
+#include "PolyRhythm.h"
+#include "Utils.h"
+
+#ifndef RWF_NOWAIT
+#define RWF_NOWAIT 0x00000008
+#endif
+
+/* Extern trigger flags
+ * To stop attack primitives
+ */
+extern int disk_read_flag;
+
+extern unsigned long int diskio_contention_count;
+
+/**************************************************************
+ * Parameters for page-cache eviction read attack ************
+ * The write attacks never exercise device read latency, which read-heavy
+ * victims (map loaders, log replayers) are sensitive to. This attack
+ * reads a large file and evicts what it read, so every read goes to the
+ * device.
+ * *********************************************************************
+ */
+
+#define DISK_PATHS_ENV "POLYRHYTHM_DISK_PATHS"
+#define DISK_READ_FILL_CHUNK (1024 * KB)
+#define DISK_READ_REPORT_INTERVAL_US 1000000  // Print rates once per second
+
+/* The page cache only drops folios fully covered by a DONTNEED range, and
+ * they can be as large as a PMD (2MB with 4kB pages), so evictions are
+ * rounded out to this window.
+ */
+#define DISK_READ_EVICT_WINDOW (2 * 1024 * KB)
+
+/* The mode parameter */
+#define DISK_READ_RANDOM 0x1
+#define DISK_READ_NOWAIT 0x2  // Probe the page cache with preadv2(RWF_NOWAIT)
+
+/* Readahead advice, indexed by the advice parameter */
+static const int readahead_advice[] = {POSIX_FADV_NORMAL,
+                                       POSIX_FADV_SEQUENTIAL,
+                                       POSIX_FADV_RANDOM};
+
+/* Global variables */
+static off_t filesize;
+static int read_size;
+static int read_mode;
+static int fd = -1;  // File descriptor shared by all threads
+
+/* Totals of all threads since the start, for stats */
+static pthread_mutex_t run_lock = PTHREAD_MUTEX_INITIALIZER;
+static unsigned long run_reads, run_cache_hits;
+static latency_hist_t run_hist;
+
+/**
+ * @brief Drop the windows covering [offset, offset + len) from the page cache
+ */
+static void evict_range(off_t offset, off_t len) {
+    off_t start = offset / DISK_READ_EVICT_WINDOW * DISK_READ_EVICT_WINDOW;
+    off_t end = (offset + len + DISK_READ_EVICT_WINDOW - 1) /
+                DISK_READ_EVICT_WINDOW * DISK_READ_EVICT_WINDOW;
+
+    (void)posix_fadvise(fd, start, end - start, POSIX_FADV_DONTNEED);
+}
+
+/**
+ * @brief Initialize the disk read attack channels
+ * The file is created in the first directory of POLYRHYTHM_DISK_PATHS,
+ * or in the current directory.
+ * @param:
+ * 0: number of pages of the file
+ * 1: size of each read, in Bytes
+ * 2: readahead advice (0: normal, 1: sequential, 2: random)
+ * 3: mode, 0: sequential offsets, 1: random offsets, + 2 to probe the
+ *    page cache with preadv2(RWF_NOWAIT) before reading
+ */
+int init_disk_read_attack(void *arguments) {
+    int *args = (int *)arguments;
+    const char *env_paths = getenv(DISK_PATHS_ENV);
+    char dir[PATH_MAX], path[PATH_MAX], name[20];
+    char *buffer;
+    off_t written;
+    int advice = args[2];
+
+    filesize = (off_t)args[0] * PAGE_SIZE;
+    read_size = args[1];
+    read_mode = args[3];
+
+    if (read_size <= 0 || filesize < read_size) {
+        printf("Disk read Attack: file must be larger than one read \n");
+        return EXIT_FAILURE;
+    }
+
+    if (advice < 0 || advice >= (int)(sizeof(readahead_advice) /
+                                      sizeof(readahead_advice[0]))) {
+        printf("Disk read Attack: unknown readahead advice %d \n", advice);
+        return EXIT_FAILURE;
+    }
+
+    snprintf(dir, sizeof(dir), "%s",
+             env_paths && *env_paths ? env_paths : ".");
+    dir[strcspn(dir, ":")] = '\0';
+    rand_str(name, sizeof(name) - 1);
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+
+    fd = open(path, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        printf("Disk read Attack failed to open %s, errno=%d (%s)\n", path,
+               errno, strerror(errno));
+        return EXIT_FAILURE;
+    }
+    /* The file goes away with the process */
+    unlink(path);
+
+    /* Write real data, unwritten extents would be read without any I/O */
+    buffer = malloc(DISK_READ_FILL_CHUNK);
+    rand_str(buffer, DISK_READ_FILL_CHUNK - 1);
+    for (written = 0; written < filesize; written += DISK_READ_FILL_CHUNK) {
+        size_t len = MIN(DISK_READ_FILL_CHUNK, filesize - written);
+        if (write(fd, buffer, len) != (ssize_t)len) {
+            printf("Disk read Attack failed to fill file, errno=%d (%s)\n",
+                   errno, strerror(errno));
+            free(buffer);
+            return EXIT_FAILURE;
+        }
+    }
+    free(buffer);
+
+    /* Written pages must be clean before they can be evicted */
+    (void)fsync(fd);
+    (void)posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+
+    if (posix_fadvise(fd, 0, 0, readahead_advice[advice])) {
+        printf("Disk read Attack failed to set fadvise, errno=%d (%s)\n",
+               errno, strerror(errno));
+    }
+
+    hist_reset(&run_hist);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Add the reads of a thread to the totals
+ */
+static void add_run_totals(unsigned long reads, unsigned long cache_hits,
+                           const latency_hist_t *hist) {
+    pthread_mutex_lock(&run_lock);
+    run_reads += reads;
+    run_cache_hits += cache_hits;
+    hist_merge(&run_hist, hist);
+    pthread_mutex_unlock(&run_lock);
+}
+
+/**
+ * @brief Main disk read attack loop.
+ */
+int disk_read_attack() {
+    struct iovec iov;
+    char *buffer;
+    off_t offset = 0;
+    int mode = read_mode;  // The probe is turned off per thread
+
+    unsigned long reads = 0, cache_hits = 0;
+    long last_report = get_current_time_us();
+    latency_hist_t hist;
+
+    if (fd < 0) return EXIT_FAILURE;
+
+    if (posix_memalign((void **)&buffer, PAGE_SIZE, read_size)) {
+        printf("Disk read Attack: failed to allocate buffer \n");
+        return EXIT_FAILURE;
+    }
+    iov.iov_base = buffer;
+    iov.iov_len = read_size;
+    hist_reset(&hist);
+
+    while (attack_continue(&disk_read_flag)) {
+        uint64_t start;
+        ssize_t ret;
+
+        if (mode & DISK_READ_RANDOM) {
+            offset = rand() % (filesize - read_size + 1);
+        }
+
+        /* A cached range is evicted and read again from the device */
+        if (mode & DISK_READ_NOWAIT) {
+            ret = preadv2(fd, &iov, 1, offset, RWF_NOWAIT);
+            if (ret > 0) {
+                cache_hits++;
+                evict_range(offset, read_size);
+            } else if (ret < 0 && errno != EAGAIN) {
+                printf("Disk read Attack: RWF_NOWAIT unsupported (%s) \n",
+                       strerror(errno));
+                mode &= ~DISK_READ_NOWAIT;
+            }
+        }
+
+        start = get_current_time_ns();
+        ret = pread(fd, buffer, read_size, offset);
+        if (ret < 0) {
+            printf("Disk read Attack failed to read, errno=%d (%s)\n", errno,
+                   strerror(errno));
+            free(buffer);
+            return EXIT_FAILURE;
+        }
+        hist_record(&hist, get_current_time_ns() - start);
+
+        /* Drop what we just read, the next pass has to hit the device.
+         * Sequential reads only drop the windows left behind, so that the
+         * readahead of the current window is not thrown away.
+         */
+        if (mode & DISK_READ_RANDOM) {
+            evict_range(offset, read_size);
+        } else {
+            off_t next = offset + read_size;
+            off_t window = offset / DISK_READ_EVICT_WINDOW;
+
+            if (next + read_size > filesize) {
+                evict_range(window * DISK_READ_EVICT_WINDOW,
+                            filesize - window * DISK_READ_EVICT_WINDOW);
+                next = 0;
+            } else if (next / DISK_READ_EVICT_WINDOW != window) {
+                (void)posix_fadvise(
+                    fd, window * DISK_READ_EVICT_WINDOW,
+                    (next / DISK_READ_EVICT_WINDOW - window) *
+                        DISK_READ_EVICT_WINDOW,
+                    POSIX_FADV_DONTNEED);
+            }
+            offset = next;
+        }
+
+        reads++;
+        /* Count the disk I/O loop, less count means more contention */
+        diskio_contention_count++;
+
+        long now = get_current_time_us();
+        if (now - last_report >= DISK_READ_REPORT_INTERVAL_US) {
+            printf("[Disk read] %.0f reads/s, %.2f MB/s",
+                   (double)reads / (now - last_report) * MICROSEC,
+                   (double)reads * read_size / (now - last_report));
+            if (mode & DISK_READ_NOWAIT) {
+                printf(", %.1f%% already cached",
+                       100.0 * cache_hits / reads);
+            }
+            printf("\n");
+            hist_print(&hist, "Disk read latency");
+            add_run_totals(reads, cache_hits, &hist);
+            hist_reset(&hist);
+            reads = cache_hits = 0;
+            last_report = now;
+        }
+    }
+
+    add_run_totals(reads, cache_hits, &hist);
+    free(buffer);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Print the reads and their latency since the start
+ */
+void disk_read_attack_stats(double secs) {
+    double per_sec = secs > 0 ? 1 / secs : 0;
+
+    pthread_mutex_lock(&run_lock);
+    printf("[Disk read] total over %.1f s: %lu reads (%.0f/s), %.1f MB",
+           secs, run_reads, run_reads * per_sec,
+           (double)run_reads * read_size / MB);
+    if (read_mode & DISK_READ_NOWAIT && run_reads) {
+        printf(", %.1f%% already cached", 100.0 * run_cache_hits / run_reads);
+    }
+    printf("\n");
+    hist_print(&run_hist, "Disk read latency, total");
+    pthread_mutex_unlock(&run_lock);
+}
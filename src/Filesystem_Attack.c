@@ -0,0 +1,730 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/fanotify.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Attacks.h"
+#include "Control.h"
+#include "PolyRhythm.h"
+#include "Utils.h"
+
+/* Extern trigger flags
+ * To stop attack primitives
+ */
+extern int filesys_flag;
+extern int fsnotify_flag;
+
+/*************************************
+ * File system attack
+ * Performing  file  system  activities  such  as  making/deleting
+ * files/directories, moving files, etc.
+ * to block the kernel shared data structures (dentry/inode caches,
+ * directory locks) and stress various notify events.
+ * Every attack thread works in its own shard of the directory tree, so the
+ * rate scales with cores, and the number of live files is bounded so the
+ * disk never fills up.
+ * ***********************************
+ */
+
+#define FS_MAX_FANOUT 256        // Subdirectories per shard
+#define FS_MAX_DIRS 64           // Live directories made by mkdir per shard
+#define FS_MAX_FILE_SIZE (64 * KB)
+#define FS_DEFAULT_MIX 342311    // See the mix parameter below
+#define FS_FLUSH_OPS 256         // Publish the op counts every N ops
+#define FS_REPORT_INTERVAL_US 1000000  // Print rates once per second
+
+/* Metadata operations, in the digit order of the mix parameter */
+enum fs_op {
+    fs_create = 0,
+    fs_stat,
+    fs_rename,
+    fs_unlink,
+    fs_mkdir,
+    fs_rmdir,
+    fs_num_ops
+};
+
+static const char *fs_op_names[fs_num_ops] = {"create", "stat",  "rename",
+                                              "unlink", "mkdir", "rmdir"};
+
+/* A live file or directory: the subdirectory holding it and its name */
+struct fs_entry {
+    int dir;
+    unsigned int name;
+};
+
+/* Per-thread shard of the tree */
+struct fs_shard {
+    int subdir_fds[FS_MAX_FANOUT];
+    struct fs_entry *files;  // Dense, removal swaps in the last entry
+    int num_files;
+    struct fs_entry dirs[FS_MAX_DIRS];
+    int num_dirs;
+    unsigned int next_name;
+    unsigned int seed;
+};
+
+/* Global variables */
+static char root_path[64];
+static int max_files;
+static int fanout;
+static int file_size;
+static int mix_total;
+static int mix_cumulative[fs_num_ops];
+static char file_content[FS_MAX_FILE_SIZE];
+
+static int next_thread_index;
+static unsigned long ops_done[fs_num_ops];  // Summed over all threads
+
+static int remove_entry(const char *path, const struct stat *sb, int type,
+                        struct FTW *ftwbuf) {
+    (void)sb;
+    (void)type;
+    (void)ftwbuf;
+    (void)remove(path);
+    return 0;
+}
+
+/**
+ * @brief Remove the whole tree when the process exits
+ */
+static void filesys_cleanup(void) {
+    __atomic_store_n(&filesys_flag, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&fsnotify_flag, 0, __ATOMIC_RELAXED);
+    (void)nftw(root_path, remove_entry, 64, FTW_DEPTH | FTW_PHYS);
+}
+
+/**
+ * @brief Create the root of the tree, shared by the file system channels
+ */
+static int create_root(void) {
+    if (root_path[0] != '\0') return EXIT_SUCCESS;
+
+    snprintf(root_path, sizeof(root_path), "polyrhythm_fs.%d", getpid());
+    if (mkdir(root_path, S_IRWXU) < 0) {
+        printf("Filesystem Attack: cannot create %s: errno=%d (%s)\n",
+               root_path, errno, strerror(errno));
+        root_path[0] = '\0';
+        return EXIT_FAILURE;
+    }
+    atexit(filesys_cleanup);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Initialize the file system attack channels
+ * The tree is created under the current directory, and removed at exit.
+ * @param:
+ * 0: maximum number of live files per attack thread
+ * 1: number of subdirectories per attack thread
+ * 2: operation mix, six decimal digits weighting
+ *    create, stat, rename, unlink, mkdir and rmdir (0: 342311)
+ * 3: number of Bytes written into each created file (0: empty files)
+ */
+int init_filesys_attack(void *arguments) {
+    int *args = (int *)arguments;
+    int mix, i;
+
+    max_files = args[0];
+    fanout = args[1];
+    mix = args[2] ? args[2] : FS_DEFAULT_MIX;
+    file_size = args[3];
+
+    if (max_files <= 0 || fanout <= 0 || fanout > FS_MAX_FANOUT) {
+        printf("Filesystem Attack: need live files > 0, 0 < fanout <= %d \n",
+               FS_MAX_FANOUT);
+        return EXIT_FAILURE;
+    }
+
+    if (file_size < 0 || file_size > FS_MAX_FILE_SIZE) {
+        printf("Filesystem Attack: file size must be within [0, %d] \n",
+               FS_MAX_FILE_SIZE);
+        return EXIT_FAILURE;
+    }
+
+    /* The most significant digit weights the first operation */
+    for (i = fs_num_ops - 1; i >= 0; i--) {
+        mix_cumulative[i] = mix % 10;
+        mix /= 10;
+    }
+    for (i = 0; i < fs_num_ops; i++) {
+        mix_total += mix_cumulative[i];
+        mix_cumulative[i] = mix_total;
+    }
+    if (args[2] < 0 || mix > 0 || mix_total == 0) {
+        printf("Filesystem Attack: invalid operation mix %d \n", args[2]);
+        return EXIT_FAILURE;
+    }
+
+    (void)memset(file_content, 'x', sizeof(file_content));
+
+    return create_root();
+}
+
+/**
+ * @brief Close the subdirectories of a shard and free its file list, the
+ * entries themselves are removed with the tree
+ */
+static void free_shard(struct fs_shard *shard) {
+    int i;
+
+    for (i = 0; i < fanout; i++) {
+        if (shard->subdir_fds[i] >= 0) close(shard->subdir_fds[i]);
+    }
+    free(shard->files);
+}
+
+/**
+ * @brief Create this thread's shard: <root>/t<index>/d<0..fanout-1>
+ */
+static int init_shard(struct fs_shard *shard, int index) {
+    char name[32];
+    int shard_fd, i;
+
+    memset(shard, 0, sizeof(*shard));
+    for (i = 0; i < FS_MAX_FANOUT; i++) shard->subdir_fds[i] = -1;
+    shard->seed = (unsigned int)(get_current_time_us() ^ index);
+    shard->files = malloc(sizeof(struct fs_entry) * max_files);
+    if (shard->files == NULL) {
+        printf("Filesystem Attack: cannot allocate the file list \n");
+        return EXIT_FAILURE;
+    }
+
+    snprintf(name, sizeof(name), "%s/t%d", root_path, index);
+    if (mkdir(name, S_IRWXU) < 0 ||
+        (shard_fd = open(name, O_RDONLY | O_DIRECTORY)) < 0) {
+        printf("Filesystem Attack: cannot create %s: errno=%d (%s)\n", name,
+               errno, strerror(errno));
+        free_shard(shard);
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < fanout; i++) {
+        snprintf(name, sizeof(name), "d%d", i);
+        if (mkdirat(shard_fd, name, S_IRWXU) < 0 ||
+            (shard->subdir_fds[i] =
+                 openat(shard_fd, name, O_RDONLY | O_DIRECTORY)) < 0) {
+            printf("Filesystem Attack: cannot create %s: errno=%d (%s)\n",
+                   name, errno, strerror(errno));
+            close(shard_fd);
+            free_shard(shard);
+            return EXIT_FAILURE;
+        }
+    }
+
+    close(shard_fd);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Pick the next operation, falling back to its counterpart when
+ * the shard is full (or empty)
+ */
+static enum fs_op pick_op(struct fs_shard *shard) {
+    int r = rand_r(&shard->seed) % mix_total;
+    enum fs_op op = fs_create;
+
+    while (r >= mix_cumulative[op]) op++;
+
+    switch (op) {
+        case fs_create:
+            return shard->num_files < max_files ? fs_create : fs_unlink;
+        case fs_stat:
+        case fs_rename:
+        case fs_unlink:
+            return shard->num_files > 0 ? op : fs_create;
+        case fs_mkdir:
+            return shard->num_dirs < FS_MAX_DIRS ? fs_mkdir : fs_rmdir;
+        case fs_rmdir:
+            return shard->num_dirs > 0 ? fs_rmdir : fs_mkdir;
+        default:
+            return fs_create;
+    }
+}
+
+/**
+ * @brief Run one metadata operation on the shard
+ */
+static int do_op(struct fs_shard *shard, enum fs_op op) {
+    char name[16], new_name[16];
+    struct fs_entry *entry;
+    struct stat st;
+    int fd, dir, i;
+
+    switch (op) {
+        case fs_create:
+            entry = &shard->files[shard->num_files];
+            entry->dir = rand_r(&shard->seed) % fanout;
+            entry->name = shard->next_name++;
+            snprintf(name, sizeof(name), "f%u", entry->name);
+            fd = openat(shard->subdir_fds[entry->dir], name,
+                        O_CREAT | O_EXCL | O_WRONLY, S_IRUSR | S_IWUSR);
+            if (fd < 0) break;
+            if (file_size > 0 && write(fd, file_content, file_size) < 0) {
+                close(fd);
+                break;
+            }
+            close(fd);
+            shard->num_files++;
+            return EXIT_SUCCESS;
+
+        case fs_stat:
+            entry = &shard->files[rand_r(&shard->seed) % shard->num_files];
+            snprintf(name, sizeof(name), "f%u", entry->name);
+            if (fstatat(shard->subdir_fds[entry->dir], name, &st, 0) < 0)
+                break;
+            return EXIT_SUCCESS;
+
+        case fs_rename:
+            /* Mostly across directories, to take the rename lock */
+            entry = &shard->files[rand_r(&shard->seed) % shard->num_files];
+            dir = rand_r(&shard->seed) % fanout;
+            snprintf(name, sizeof(name), "f%u", entry->name);
+            snprintf(new_name, sizeof(new_name), "f%u", shard->next_name);
+            if (renameat(shard->subdir_fds[entry->dir], name,
+                         shard->subdir_fds[dir], new_name) < 0)
+                break;
+            entry->dir = dir;
+            entry->name = shard->next_name++;
+            return EXIT_SUCCESS;
+
+        case fs_unlink:
+            i = rand_r(&shard->seed) % shard->num_files;
+            entry = &shard->files[i];
+            snprintf(name, sizeof(name), "f%u", entry->name);
+            if (unlinkat(shard->subdir_fds[entry->dir], name, 0) < 0) break;
+            *entry = shard->files[--shard->num_files];
+            return EXIT_SUCCESS;
+
+        case fs_mkdir:
+            entry = &shard->dirs[shard->num_dirs];
+            entry->dir = rand_r(&shard->seed) % fanout;
+            entry->name = shard->next_name++;
+            snprintf(name, sizeof(name), "x%u", entry->name);
+            if (mkdirat(shard->subdir_fds[entry->dir], name, S_IRWXU) < 0)
+                break;
+            shard->num_dirs++;
+            return EXIT_SUCCESS;
+
+        case fs_rmdir:
+            i = rand_r(&shard->seed) % shard->num_dirs;
+            entry = &shard->dirs[i];
+            snprintf(name, sizeof(name), "x%u", entry->name);
+            if (unlinkat(shard->subdir_fds[entry->dir], name, AT_REMOVEDIR) <
+                0)
+                break;
+            *entry = shard->dirs[--shard->num_dirs];
+            return EXIT_SUCCESS;
+
+        default:
+            return EXIT_SUCCESS;
+    }
+
+    printf("Filesystem Attack: %s failed, errno=%d (%s)\n", fs_op_names[op],
+           errno, strerror(errno));
+    return EXIT_FAILURE;
+}
+
+/**
+ * @brief Main file system attack loop.
+ */
+int filesys_attack() {
+    struct fs_shard shard;
+    unsigned long local_ops[fs_num_ops] = {0};
+    unsigned long last_ops[fs_num_ops] = {0};
+    unsigned long pending = 0;
+    long last_report = get_current_time_us();
+    int index, i, ret = EXIT_SUCCESS;
+
+    index = __atomic_fetch_add(&next_thread_index, 1, __ATOMIC_RELAXED);
+    if (init_shard(&shard, index) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    while (attack_continue(&filesys_flag)) {
+        enum fs_op op = pick_op(&shard);
+
+        if (do_op(&shard, op) != EXIT_SUCCESS) {
+            ret = EXIT_FAILURE;
+            break;
+        }
+        local_ops[op]++;
+
+        if (++pending < FS_FLUSH_OPS) continue;
+        pending = 0;
+
+        for (i = 0; i < fs_num_ops; i++) {
+            __atomic_fetch_add(&ops_done[i], local_ops[i], __ATOMIC_RELAXED);
+            local_ops[i] = 0;
+        }
+
+        /* The first attack thread reports for all of them */
+        long now = get_current_time_us();
+        if (index == 0 && now - last_report >= FS_REPORT_INTERVAL_US) {
+            unsigned long ops[fs_num_ops], total = 0;
+
+            for (i = 0; i < fs_num_ops; i++) {
+                ops[i] = __atomic_load_n(&ops_done[i], __ATOMIC_RELAXED) -
+                         last_ops[i];
+                last_ops[i] += ops[i];
+                total += ops[i];
+            }
+
+            printf("[Filesystem] %.0f ops/s over %d threads (",
+                   (double)total / (now - last_report) * MICROSEC,
+                   __atomic_load_n(&next_thread_index, __ATOMIC_RELAXED));
+            for (i = 0; i < fs_num_ops; i++) {
+                printf("%s %.0f%s", fs_op_names[i],
+                       (double)ops[i] / (now - last_report) * MICROSEC,
+                       i < fs_num_ops - 1 ? ", " : ")\n");
+            }
+            last_report = now;
+        }
+    }
+
+    for (i = 0; i < fs_num_ops; i++)
+        __atomic_fetch_add(&ops_done[i], local_ops[i], __ATOMIC_RELAXED);
+
+    free_shard(&shard);
+    return ret;
+}
+
+/**
+ * @brief Print the operations of all threads since the start
+ */
+void filesys_attack_stats(double secs) {
+    double per_sec = secs > 0 ? 1 / secs : 0;
+    unsigned long total = 0;
+    int i;
+
+    for (i = 0; i < fs_num_ops; i++) total += ops_done[i];
+    printf("[Filesystem] total over %.1f s: %lu ops (%.0f/s; ", secs, total,
+           total * per_sec);
+    for (i = 0; i < fs_num_ops; i++) {
+        printf("%s %lu%s", fs_op_names[i], ops_done[i],
+               i < fs_num_ops - 1 ? ", " : ")\n");
+    }
+}
+
+/*************************************
+ * File system notification attack
+ * Registers many inotify (and optionally fanotify) watches over a tree of
+ * directories, while the attack threads generate events in it, so the
+ * kernel spends its time queueing and delivering events. A drain thread
+ * reads all the queues, like the watching daemons of the victim would.
+ * ***********************************
+ */
+
+#define FSN_MAX_DIRS 4096
+#define FSN_MAX_INSTANCES 128
+#define FSN_EVENT_BUF (64 * KB)
+#define FSN_EVENTS_PER_ITER 4  // create, modify, close, delete
+#define FSN_FLUSH_ITERS 64     // Publish the event count every N iterations
+#define FSN_INOTIFY_MASK (IN_CREATE | IN_MODIFY | IN_CLOSE_WRITE | IN_DELETE)
+
+/* The mode parameter */
+#define FSN_FANOTIFY 0x1
+
+/* Global variables */
+static int num_watch_dirs;
+static int num_instances;
+static int event_rate;
+static int watch_dir_fds[FSN_MAX_DIRS];
+static struct pollfd notify_fds[FSN_MAX_INSTANCES + 1];
+static int num_notify_fds;
+static int fanotify_fd = -1;
+
+static int next_generator_index;
+static unsigned long events_generated;  // Summed over all threads
+static unsigned long events_drained;
+static unsigned long queue_overflows;
+
+/**
+ * @brief Count the events in a buffer read from a notification queue
+ */
+static unsigned long count_events(int fd, char *buffer, ssize_t len) {
+    unsigned long events = 0;
+    char *ptr;
+
+    if (fd == fanotify_fd) {
+#ifdef FAN_REPORT_FID
+        struct fanotify_event_metadata *meta =
+            (struct fanotify_event_metadata *)buffer;
+
+        for (; FAN_EVENT_OK(meta, len); meta = FAN_EVENT_NEXT(meta, len)) {
+            if (meta->mask & FAN_Q_OVERFLOW) queue_overflows++;
+            if (meta->fd >= 0) close(meta->fd);
+            events++;
+        }
+#endif
+        return events;
+    }
+
+    for (ptr = buffer; ptr < buffer + len;) {
+        struct inotify_event *event = (struct inotify_event *)ptr;
+
+        if (event->mask & IN_Q_OVERFLOW) queue_overflows++;
+        ptr += sizeof(struct inotify_event) + event->len;
+        events++;
+    }
+    return events;
+}
+
+/**
+ * @brief Drain thread, reads every notification queue as events arrive
+ */
+static void *drain_notify_events(void *arg) {
+    char *buffer = malloc(FSN_EVENT_BUF);
+    int i;
+
+    (void)arg;
+    while (1) {
+        if (poll(notify_fds, num_notify_fds, -1) < 0) {
+            if (errno == EINTR) continue;
+            printf("Fsnotify Attack: poll failed, errno=%d (%s)\n", errno,
+                   strerror(errno));
+            break;
+        }
+
+        for (i = 0; i < num_notify_fds; i++) {
+            ssize_t len;
+
+            if (!(notify_fds[i].revents & POLLIN)) continue;
+            while ((len = read(notify_fds[i].fd, buffer, FSN_EVENT_BUF)) > 0) {
+                __atomic_fetch_add(
+                    &events_drained,
+                    count_events(notify_fds[i].fd, buffer, len),
+                    __ATOMIC_RELAXED);
+            }
+        }
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+/**
+ * @brief Add a fanotify group marking every watched directory
+ * Uses FAN_REPORT_FID, which unprivileged users may do since Linux 5.13.
+ */
+static int init_fanotify(void) {
+#ifdef FAN_REPORT_FID
+    char path[PATH_MAX];
+    int i;
+
+    fanotify_fd =
+        fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_FID | FAN_NONBLOCK, O_RDONLY);
+    if (fanotify_fd < 0) {
+        printf("Fsnotify Attack: fanotify unavailable, errno=%d (%s)\n", errno,
+               strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < num_watch_dirs; i++) {
+        snprintf(path, sizeof(path), "%s/n%d", root_path, i);
+        if (fanotify_mark(fanotify_fd, FAN_MARK_ADD,
+                          FAN_CREATE | FAN_MODIFY | FAN_CLOSE_WRITE |
+                              FAN_DELETE | FAN_EVENT_ON_CHILD,
+                          AT_FDCWD, path) < 0) {
+            printf("Fsnotify Attack: cannot mark %s, errno=%d (%s)\n", path,
+                   errno, strerror(errno));
+            close(fanotify_fd);
+            fanotify_fd = -1;
+            return EXIT_FAILURE;
+        }
+    }
+
+    notify_fds[num_notify_fds].fd = fanotify_fd;
+    notify_fds[num_notify_fds++].events = POLLIN;
+    return EXIT_SUCCESS;
+#else
+    printf("Fsnotify Attack: fanotify FID reporting not supported \n");
+    return EXIT_FAILURE;
+#endif
+}
+
+/**
+ * @brief Initialize the file system notification attack channels
+ * The watched directories are created next to the file system attack tree.
+ * @param:
+ * 0: number of watched directories
+ * 1: number of inotify instances, each watching every directory
+ * 2: events generated per second by each attack thread (0: unthrottled)
+ * 3: mode, 1 to also mark every directory with fanotify
+ */
+int init_fsnotify_attack(void *arguments) {
+    int *args = (int *)arguments;
+    char path[PATH_MAX];
+    pthread_t drain;
+    int i, j;
+
+    num_watch_dirs = args[0];
+    num_instances = args[1];
+    event_rate = args[2];
+
+    if (num_watch_dirs <= 0 || num_watch_dirs > FSN_MAX_DIRS ||
+        num_instances < 0 || num_instances > FSN_MAX_INSTANCES ||
+        event_rate < 0) {
+        printf("Fsnotify Attack: need 0 < dirs <= %d, 0 <= instances <= %d \n",
+               FSN_MAX_DIRS, FSN_MAX_INSTANCES);
+        return EXIT_FAILURE;
+    }
+
+    if (create_root() != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    for (i = 0; i < num_watch_dirs; i++) {
+        snprintf(path, sizeof(path), "%s/n%d", root_path, i);
+        if (mkdir(path, S_IRWXU) < 0 ||
+            (watch_dir_fds[i] = open(path, O_RDONLY | O_DIRECTORY)) < 0) {
+            printf("Fsnotify Attack: cannot create %s: errno=%d (%s)\n", path,
+                   errno, strerror(errno));
+            return EXIT_FAILURE;
+        }
+    }
+
+    for (j = 0; j < num_instances; j++) {
+        int fd = inotify_init1(IN_NONBLOCK);
+
+        if (fd < 0) {
+            printf("Fsnotify Attack: inotify_init failed, errno=%d (%s), "
+                   "see /proc/sys/fs/inotify/max_user_instances \n",
+                   errno, strerror(errno));
+            return EXIT_FAILURE;
+        }
+
+        for (i = 0; i < num_watch_dirs; i++) {
+            snprintf(path, sizeof(path), "%s/n%d", root_path, i);
+            if (inotify_add_watch(fd, path, FSN_INOTIFY_MASK) < 0) {
+                printf("Fsnotify Attack: cannot watch %s, errno=%d (%s), "
+                       "see /proc/sys/fs/inotify/max_user_watches \n",
+                       path, errno, strerror(errno));
+                return EXIT_FAILURE;
+            }
+        }
+
+        notify_fds[num_notify_fds].fd = fd;
+        notify_fds[num_notify_fds++].events = POLLIN;
+    }
+
+    /* Keep going with inotify only if fanotify is refused */
+    if (args[3] & FSN_FANOTIFY) (void)init_fanotify();
+
+    if (num_notify_fds > 0) {
+        if (pthread_create(&drain, NULL, drain_notify_events, NULL) != 0) {
+            printf("Fsnotify Attack: cannot create drain thread \n");
+            return EXIT_FAILURE;
+        }
+        pthread_detach(drain);
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Main file system notification attack loop.
+ * Every iteration creates, writes, closes and deletes a file in one of the
+ * watched directories.
+ */
+int fsnotify_attack() {
+    char name[16];
+    unsigned long local_events = 0, iters = 0;
+    unsigned long last_generated = 0, last_drained = 0, last_overflows = 0;
+    long last_report = get_current_time_us();
+    uint64_t interval_ns = 0, deadline = get_current_time_ns();
+    unsigned int seed;
+    int index, ret = EXIT_SUCCESS;
+
+    index = __atomic_fetch_add(&next_generator_index, 1, __ATOMIC_RELAXED);
+    seed = (unsigned int)(get_current_time_us() ^ index);
+    snprintf(name, sizeof(name), "g%d", index);
+    if (event_rate > 0) {
+        interval_ns = (uint64_t)FSN_EVENTS_PER_ITER * NANOSEC / event_rate;
+    }
+
+    while (attack_continue(&fsnotify_flag)) {
+        int dir_fd = watch_dir_fds[rand_r(&seed) % num_watch_dirs];
+        int fd = openat(dir_fd, name, O_CREAT | O_WRONLY | O_TRUNC,
+                        S_IRUSR | S_IWUSR);
+
+        if (fd < 0) {
+            printf("Fsnotify Attack: cannot create file, errno=%d (%s)\n",
+                   errno, strerror(errno));
+            ret = EXIT_FAILURE;
+            break;
+        }
+        (void)write(fd, name, 1);
+        close(fd);
+        (void)unlinkat(dir_fd, name, 0);
+        local_events += FSN_EVENTS_PER_ITER;
+
+        /* Pace to the event rate, without bursting after falling behind */
+        if (interval_ns) {
+            uint64_t now = get_current_time_ns();
+
+            deadline += interval_ns;
+            if (deadline > now) {
+                struct timespec ts = {.tv_sec = deadline / NANOSEC,
+                                      .tv_nsec = deadline % NANOSEC};
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+            } else if (now - deadline > NANOSEC) {
+                deadline = now;
+            }
+        }
+
+        if (++iters % FSN_FLUSH_ITERS) continue;
+        __atomic_fetch_add(&events_generated, local_events, __ATOMIC_RELAXED);
+        local_events = 0;
+
+        /* The first attack thread reports for all of them */
+        long now = get_current_time_us();
+        if (index == 0 && now - last_report >= FS_REPORT_INTERVAL_US) {
+            unsigned long generated, drained, overflows;
+
+            generated = __atomic_load_n(&events_generated, __ATOMIC_RELAXED);
+            drained = __atomic_load_n(&events_drained, __ATOMIC_RELAXED);
+            overflows = __atomic_load_n(&queue_overflows, __ATOMIC_RELAXED);
+            printf("[Fsnotify] generated %.0f events/s, drained %.0f events/s "
+                   "from %d inotify instances%s, %lu queue overflows\n",
+                   (double)(generated - last_generated) /
+                       (now - last_report) * MICROSEC,
+                   (double)(drained - last_drained) / (now - last_report) *
+                       MICROSEC,
+                   num_instances, fanotify_fd >= 0 ? " + fanotify" : "",
+                   overflows - last_overflows);
+            last_generated = generated;
+            last_drained = drained;
+            last_overflows = overflows;
+            last_report = now;
+        }
+    }
+
+    __atomic_fetch_add(&events_generated, local_events, __ATOMIC_RELAXED);
+
+    return ret;
+}
+
+/**
+ * @brief Print the events generated and drained since the start
+ */
+void fsnotify_attack_stats(double secs) {
+    double per_sec = secs > 0 ? 1 / secs : 0;
+    unsigned long generated, drained;
+
+    generated = __atomic_load_n(&events_generated, __ATOMIC_RELAXED);
+    drained = __atomic_load_n(&events_drained, __ATOMIC_RELAXED);
+    printf("[Fsnotify] total over %.1f s: generated %lu events (%.0f/s), "
+           "drained %lu (%.0f/s), %lu queue overflows\n",
+           secs, generated, generated * per_sec, drained, drained * per_sec,
+           __atomic_load_n(&queue_overflows, __ATOMIC_RELAXED));
+}
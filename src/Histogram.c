@@ -0,0 +1,134 @@
+#include "Histogram.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * @brief Map a value to its bucket index
+ * Values below HIST_SUB_BUCKETS get one bucket each; above that, the
+ * bucket is the position of the top bit plus the next HIST_SUB_BITS bits.
+ */
+static int hist_bucket(uint64_t value) {
+    int msb;
+
+    if (value < HIST_SUB_BUCKETS) return (int)value;
+
+    msb = 63 - __builtin_clzll(value);
+    return ((msb - HIST_SUB_BITS + 1) << HIST_SUB_BITS) +
+           (int)((value >> (msb - HIST_SUB_BITS)) & (HIST_SUB_BUCKETS - 1));
+}
+
+/**
+ * @brief Smallest value that falls into a bucket
+ */
+static uint64_t hist_bucket_floor(int bucket) {
+    int group = bucket >> HIST_SUB_BITS;
+    uint64_t sub = bucket & (HIST_SUB_BUCKETS - 1);
+
+    if (group == 0) return sub;
+    return (HIST_SUB_BUCKETS + sub) << (group - 1);
+}
+
+/**
+ * @brief Clear all samples
+ */
+void hist_reset(latency_hist_t *h) {
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+/**
+ * @brief Record one sample
+ */
+void hist_record(latency_hist_t *h, uint64_t value) {
+    h->buckets[hist_bucket(value)]++;
+    h->count++;
+    h->sum += value;
+    if (value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+}
+
+/**
+ * @brief Accumulate the samples of src into dst
+ */
+void hist_merge(latency_hist_t *dst, const latency_hist_t *src) {
+    int i;
+
+    for (i = 0; i < HIST_NUM_BUCKETS; i++) dst->buckets[i] += src->buckets[i];
+    dst->count += src->count;
+    dst->sum += src->sum;
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+/**
+ * @brief Publish a histogram, same sequence lock as perf_rates_t
+ */
+void hist_publish(latency_hist_shm_t *dst, const latency_hist_t *h,
+                  uint64_t time_ns) {
+    uint32_t seq = __atomic_load_n(&dst->seq, __ATOMIC_RELAXED);
+
+    __atomic_store_n(&dst->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    dst->time_ns = time_ns;
+    memcpy(&dst->hist, h, sizeof(*h));
+    __atomic_store_n(&dst->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/**
+ * @brief Read a published histogram, retrying while it is written
+ */
+int hist_read(const latency_hist_shm_t *src, latency_hist_t *h) {
+    uint32_t seq;
+
+    do {
+        while ((seq = __atomic_load_n(&src->seq, __ATOMIC_ACQUIRE)) & 1)
+            ;
+        memcpy(h, &src->hist, sizeof(*h));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&src->seq, __ATOMIC_RELAXED) != seq);
+
+    return seq != 0;
+}
+
+/**
+ * @brief Estimate a percentile
+ * @pct: percentile in [0, 100]
+ * @return: lower bound of the bucket holding the percentile, clamped to
+ * the observed maximum
+ */
+uint64_t hist_percentile(const latency_hist_t *h, double pct) {
+    uint64_t target, seen = 0;
+    int i;
+
+    if (h->count == 0) return 0;
+
+    target = (uint64_t)(pct / 100.0 * h->count);
+    if (target >= h->count) target = h->count - 1;
+
+    for (i = 0; i < HIST_NUM_BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen > target) break;
+    }
+
+    if (i == HIST_NUM_BUCKETS) return h->max;
+    return hist_bucket_floor(i) > h->max ? h->max : hist_bucket_floor(i);
+}
+
+/**
+ * @brief Print a one-line summary, values are in ns
+ */
+void hist_print(const latency_hist_t *h, const char *tag) {
+    if (h->count == 0) {
+        printf("[%s] no samples \n", tag);
+        return;
+    }
+
+    printf(
+        "[%s] n=%llu mean=%.1fus p50=%.1fus p90=%.1fus p99=%.1fus "
+        "p99.9=%.1fus max=%.1fus \n",
+        tag, (unsigned long long)h->count, (double)h->sum / h->count / 1000.0,
+        hist_percentile(h, 50) / 1000.0, hist_percentile(h, 90) / 1000.0,
+        hist_percentile(h, 99) / 1000.0, hist_percentile(h, 99.9) / 1000.0,
+        h->max / 1000.0);
+}
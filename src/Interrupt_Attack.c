@@ -0,0 +1,404 @@
+#define _GNU_SOURCE
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/membarrier.h>
+#include <netinet/in.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Attacks.h"
+#include "Control.h"
+#include "PolyRhythm.h"
+#include "Utils.h"
+
+/* Extern trigger flags
+ * To stop attack primitives
+ */
+extern int interrupt_flag;
+
+/*************************************
+ * Interrupt attack
+ * Generates interrupt load on target CPUs with what an unprivileged
+ * process can do:
+ *  - timer interrupts, from many short periodic hrtimers (timerfd)
+ *  - IPIs, from membarrier(MEMBARRIER_CMD_PRIVATE_EXPEDITED), which
+ *    interrupts every CPU currently running one of our threads
+ *  - migrations, moving the attack thread across the target CPUs with
+ *    sched_setaffinity (rescheduling IPIs and stopper work)
+ *  - network softirqs, from UDP packets sent over the loopback
+ * The generated rate is measured from /proc/interrupts and /proc/softirqs.
+ * ***********************************
+ */
+
+#define IRQ_MAX_TIMERS 1024
+#define IRQ_MAX_CPUS 32  // The CPU mask parameter is an int
+#define IRQ_PACKET_BURST 16
+#define IRQ_PACKET_SIZE 64
+#define IRQ_MAX_LINE 4096
+#define IRQ_REPORT_INTERVAL_US 1000000  // Print rates once per second
+
+/* The sources parameter */
+#define IRQ_SRC_TIMERS 0x1
+#define IRQ_SRC_MEMBARRIER 0x2
+#define IRQ_SRC_MIGRATION 0x4
+#define IRQ_SRC_SOFTIRQ 0x8
+#define IRQ_SRC_ALL 0xf
+
+/* Rows reported from /proc/interrupts (x86 names) and /proc/softirqs */
+static const char *irq_labels[] = {"LOC", "RES", "CAL", "TLB"};
+static const char *softirq_labels[] = {"TIMER", "HRTIMER", "NET_RX", "SCHED"};
+#define NUM_IRQ_LABELS (sizeof(irq_labels) / sizeof(irq_labels[0]))
+#define NUM_SOFTIRQ_LABELS (sizeof(softirq_labels) / sizeof(softirq_labels[0]))
+
+/* Global variables */
+static int sources;
+static int target_cpus[IRQ_MAX_CPUS];
+static int num_target_cpus;
+static unsigned int cpu_mask;  // 0: every CPU
+static int num_timers;
+static uint64_t timer_period_ns;
+
+static int next_thread_index;
+
+/**
+ * @brief Sum the counters of the target CPUs in /proc/interrupts or
+ * /proc/softirqs
+ * @counts: one entry per label, plus the total of all rows at the end
+ */
+static int read_irq_counts(const char *path, const char **labels, int nlabels,
+                           unsigned long long *counts) {
+    char line[IRQ_MAX_LINE];
+    int columns[CPU_SETSIZE];
+    int ncolumns = 0, i;
+    FILE *f = fopen(path, "r");
+
+    if (f == NULL) return EXIT_FAILURE;
+    memset(counts, 0, sizeof(*counts) * (nlabels + 1));
+
+    /* Header: CPU numbers of the columns */
+    if (fgets(line, sizeof(line), f) != NULL) {
+        char *tok = strtok(line, " \t\n");
+
+        while (tok != NULL && ncolumns < CPU_SETSIZE) {
+            if (sscanf(tok, "CPU%d", &columns[ncolumns]) == 1) ncolumns++;
+            tok = strtok(NULL, " \t\n");
+        }
+    }
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        unsigned long long sum = 0;
+        char *label = line, *ptr = strchr(line, ':'), *end;
+
+        if (ptr == NULL) continue;
+        *ptr++ = '\0';
+        while (*label == ' ') label++;
+
+        for (i = 0; i < ncolumns; i++) {
+            unsigned long long value = strtoull(ptr, &end, 10);
+
+            if (end == ptr) break;  // Rows with fewer columns (e.g. ERR)
+            ptr = end;
+            if (cpu_mask == 0 || (columns[i] < IRQ_MAX_CPUS &&
+                                  (cpu_mask & (1U << columns[i]))))
+                sum += value;
+        }
+
+        for (i = 0; i < nlabels; i++) {
+            if (strcmp(label, labels[i]) == 0) counts[i] += sum;
+        }
+        counts[nlabels] += sum;
+    }
+
+    fclose(f);
+    return EXIT_SUCCESS;
+}
+
+/* Counters when the first attack thread started, for stats */
+static unsigned long long start_irqs[NUM_IRQ_LABELS + 1];
+static unsigned long long start_softirqs[NUM_SOFTIRQ_LABELS + 1];
+static uint64_t start_ns;
+
+/**
+ * @brief Print the interrupt and softirq rates between two samples
+ */
+static void print_irq_rates(const unsigned long long *irqs,
+                            const unsigned long long *last_irqs,
+                            const unsigned long long *softirqs,
+                            const unsigned long long *last_softirqs,
+                            double secs) {
+    unsigned int i;
+
+    printf("%.0f irqs/s (",
+           (irqs[NUM_IRQ_LABELS] - last_irqs[NUM_IRQ_LABELS]) / secs);
+    for (i = 0; i < NUM_IRQ_LABELS; i++) {
+        printf("%s %.0f%s", irq_labels[i], (irqs[i] - last_irqs[i]) / secs,
+               i < NUM_IRQ_LABELS - 1 ? ", " : "), softirqs/s (");
+    }
+    for (i = 0; i < NUM_SOFTIRQ_LABELS; i++) {
+        printf("%s %.0f%s", softirq_labels[i],
+               (softirqs[i] - last_softirqs[i]) / secs,
+               i < NUM_SOFTIRQ_LABELS - 1 ? ", " : ")\n");
+    }
+}
+
+/**
+ * @brief Print the interrupt and softirq rates since the last call
+ */
+static void report_irq_rates(long elapsed_us) {
+    static unsigned long long last_irqs[NUM_IRQ_LABELS + 1];
+    static unsigned long long last_softirqs[NUM_SOFTIRQ_LABELS + 1];
+    static int primed;
+    unsigned long long irqs[NUM_IRQ_LABELS + 1];
+    unsigned long long softirqs[NUM_SOFTIRQ_LABELS + 1];
+
+    if (read_irq_counts("/proc/interrupts", irq_labels, NUM_IRQ_LABELS,
+                        irqs) != EXIT_SUCCESS ||
+        read_irq_counts("/proc/softirqs", softirq_labels, NUM_SOFTIRQ_LABELS,
+                        softirqs) != EXIT_SUCCESS)
+        return;
+
+    if (primed) {
+        printf("[Interrupt] ");
+        print_irq_rates(irqs, last_irqs, softirqs, last_softirqs,
+                        (double)elapsed_us / MICROSEC);
+    } else {
+        memcpy(start_irqs, irqs, sizeof(irqs));
+        memcpy(start_softirqs, softirqs, sizeof(softirqs));
+        start_ns = get_current_time_ns();
+    }
+
+    memcpy(last_irqs, irqs, sizeof(irqs));
+    memcpy(last_softirqs, softirqs, sizeof(softirqs));
+    primed = 1;
+}
+
+/**
+ * @brief Initialize the interrupt attack channels
+ * @param:
+ * 0: sources, 1: hrtimers, 2: membarrier IPIs, 4: migrations,
+ *    8: network softirqs (0: all of them)
+ * 1: target CPUs, as a bit mask (0: every online CPU)
+ * 2: number of hrtimers per attack thread
+ * 3: hrtimer period, in us
+ */
+int init_interrupt_attack(void *arguments) {
+    int *args = (int *)arguments;
+    int ncpus = sysconf(_SC_NPROCESSORS_ONLN), cpu;
+
+    sources = args[0] ? args[0] : IRQ_SRC_ALL;
+    cpu_mask = (unsigned int)args[1];
+    num_timers = args[2];
+    timer_period_ns = (uint64_t)args[3] * 1000;
+
+    if ((sources & IRQ_SRC_TIMERS) &&
+        (num_timers <= 0 || num_timers > IRQ_MAX_TIMERS || args[3] <= 0)) {
+        printf("Interrupt Attack: need 0 < timers <= %d and a period \n",
+               IRQ_MAX_TIMERS);
+        return EXIT_FAILURE;
+    }
+
+    for (cpu = 0; cpu < ncpus && cpu < IRQ_MAX_CPUS; cpu++) {
+        if (cpu_mask == 0 || (cpu_mask & (1U << cpu)))
+            target_cpus[num_target_cpus++] = cpu;
+    }
+    if (num_target_cpus == 0) {
+        printf("Interrupt Attack: no online CPU in mask 0x%x \n", cpu_mask);
+        return EXIT_FAILURE;
+    }
+
+    if (sources & IRQ_SRC_MEMBARRIER) {
+        if (syscall(SYS_membarrier,
+                    MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED, 0, 0) < 0) {
+            printf("Interrupt Attack: membarrier unavailable (%s) \n",
+                   strerror(errno));
+            sources &= ~IRQ_SRC_MEMBARRIER;
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Pin the calling thread on one CPU
+ */
+static void move_to_cpu(int cpu) {
+    cpu_set_t set;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    (void)sched_setaffinity(0, sizeof(set), &set);
+}
+
+/**
+ * @brief Arm the periodic timers, staggered over one period
+ */
+static int arm_timers(int epfd, int *timers) {
+    struct epoll_event ev = {.events = EPOLLIN};
+    uint64_t now = get_current_time_ns();
+    int i;
+
+    for (i = 0; i < num_timers; i++) {
+        uint64_t first = now + timer_period_ns +
+                         timer_period_ns * i / num_timers;
+        struct itimerspec its = {
+            .it_value = {.tv_sec = first / NANOSEC,
+                         .tv_nsec = first % NANOSEC},
+            .it_interval = {.tv_sec = timer_period_ns / NANOSEC,
+                            .tv_nsec = timer_period_ns % NANOSEC}};
+
+        timers[i] = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+        if (timers[i] < 0 ||
+            timerfd_settime(timers[i], TFD_TIMER_ABSTIME, &its, NULL) < 0) {
+            printf("Interrupt Attack: timerfd failed, errno=%d (%s)\n", errno,
+                   strerror(errno));
+            return EXIT_FAILURE;
+        }
+        ev.data.fd = timers[i];
+        epoll_ctl(epfd, EPOLL_CTL_ADD, timers[i], &ev);
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Open a UDP socket bound on the loopback, which we send to
+ */
+static int open_loopback_socket(struct sockaddr_in *addr) {
+    socklen_t len = sizeof(*addr);
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+
+    memset(addr, 0, sizeof(*addr));
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (fd < 0 || bind(fd, (struct sockaddr *)addr, sizeof(*addr)) < 0 ||
+        getsockname(fd, (struct sockaddr *)addr, &len) < 0) {
+        printf("Interrupt Attack: cannot bind loopback socket (%s) \n",
+               strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Main interrupt attack loop.
+ */
+int interrupt_attack() {
+    struct epoll_event events[64];
+    struct sockaddr_in addr;
+    char packet[IRQ_PACKET_SIZE] = {0};
+    int *timers = NULL;
+    int epfd = -1, sock = -1, index, next_cpu, i, n;
+    int ret = EXIT_SUCCESS;
+    long last_report = get_current_time_us();
+
+    index = __atomic_fetch_add(&next_thread_index, 1, __ATOMIC_RELAXED);
+    next_cpu = index % num_target_cpus;
+    move_to_cpu(target_cpus[next_cpu]);
+
+    /* Timers fire on the CPU that armed them */
+    if (sources & IRQ_SRC_TIMERS) {
+        timers = malloc(sizeof(int) * num_timers);
+        epfd = epoll_create1(0);
+        if (timers == NULL || epfd < 0) {
+            printf("Interrupt Attack: cannot set up timers, errno=%d (%s)\n",
+                   errno, strerror(errno));
+            ret = EXIT_FAILURE;
+            goto out_close;
+        }
+        for (i = 0; i < num_timers; i++) timers[i] = -1;
+        if (arm_timers(epfd, timers)) {
+            ret = EXIT_FAILURE;
+            goto out_close;
+        }
+    }
+
+    if (sources & IRQ_SRC_SOFTIRQ) {
+        sock = open_loopback_socket(&addr);
+        if (sock < 0) {
+            ret = EXIT_FAILURE;
+            goto out_close;
+        }
+    }
+
+    if (index == 0) report_irq_rates(0);
+
+    while (attack_continue(&interrupt_flag)) {
+        if (sources & IRQ_SRC_TIMERS) {
+            /* Block only when there is nothing else to do */
+            n = epoll_wait(epfd, events, 64,
+                           sources == IRQ_SRC_TIMERS ? 100 : 0);
+            for (i = 0; i < n; i++) {
+                uint64_t expirations;
+                (void)read(events[i].data.fd, &expirations,
+                           sizeof(expirations));
+            }
+        }
+
+        if (sources & IRQ_SRC_MEMBARRIER) {
+            (void)syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED, 0,
+                          0);
+        }
+
+        if ((sources & IRQ_SRC_MIGRATION) && num_target_cpus > 1) {
+            next_cpu = (next_cpu + 1) % num_target_cpus;
+            move_to_cpu(target_cpus[next_cpu]);
+        }
+
+        if (sources & IRQ_SRC_SOFTIRQ) {
+            for (i = 0; i < IRQ_PACKET_BURST; i++) {
+                (void)sendto(sock, packet, sizeof(packet), 0,
+                             (struct sockaddr *)&addr, sizeof(addr));
+            }
+            while (recv(sock, packet, sizeof(packet), 0) > 0) {
+            }
+        }
+
+        /* The first attack thread reports for all of them */
+        long now = get_current_time_us();
+        if (index == 0 && now - last_report >= IRQ_REPORT_INTERVAL_US) {
+            report_irq_rates(now - last_report);
+            last_report = now;
+        }
+    }
+
+out_close:
+    if (timers != NULL) {
+        for (i = 0; i < num_timers; i++) {
+            if (timers[i] >= 0) close(timers[i]);
+        }
+        free(timers);
+    }
+    if (epfd >= 0) close(epfd);
+    if (sock >= 0) close(sock);
+    return ret;
+}
+
+/**
+ * @brief Print the average interrupt and softirq rates of the target CPUs
+ * since the first attack thread started
+ */
+void interrupt_attack_stats(double secs) {
+    unsigned long long irqs[NUM_IRQ_LABELS + 1];
+    unsigned long long softirqs[NUM_SOFTIRQ_LABELS + 1];
+    double wall = (double)(get_current_time_ns() - start_ns) / NANOSEC;
+
+    if (start_ns == 0 ||
+        read_irq_counts("/proc/interrupts", irq_labels, NUM_IRQ_LABELS,
+                        irqs) != EXIT_SUCCESS ||
+        read_irq_counts("/proc/softirqs", softirq_labels, NUM_SOFTIRQ_LABELS,
+                        softirqs) != EXIT_SUCCESS)
+        return;
+
+    printf("[Interrupt] average over %.1f s (%.1f s attacking): ", wall,
+           secs);
+    print_irq_rates(irqs, start_irqs, softirqs, start_softirqs, wall);
+}
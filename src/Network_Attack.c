@@ -2,6 +2,7 @@
 #include <time.h>
 
 #include "Attacks.h"
+#include "Control.h"
 #include "PolyRhythm.h"
 #include "Utils.h"
 
@@ -22,7 +23,6 @@
 
 /* All extern trigger flags */
 extern int udp_flag;
-extern struct action *shared_memory_action;
 
 /* feedbacks for RL, defined in PolyRhythm_RL.c */
 
@@ -314,14 +314,14 @@ int stress_udp_flood() {
 #ifdef RL_ONLINE
 
 #ifdef TIMER
-    while (shared_memory_action->network) {
+    while (attack_continue(&udp_flag)) {
 #else
     for (int it = 0; it < NET_ITERATIONS; it++) {
 #endif
 
 #else
     /* For normal mode of PolyRhythm */
-    while (udp_flag) {
+    while (attack_continue(&udp_flag)) {
 #endif
         // printf("UDP loop \n");
         // (void)memset(buf, data[j++ & 63], sz);
@@ -441,7 +441,7 @@ int online_profiling_stress_udp_flood() {
     printf("Number of opened ports: %d \n", num_open_ports);
 
     // udp_flag enables/disables the udp attack loop
-    while (udp_flag) {
+    while (attack_continue(&udp_flag)) {
         // We can either use time or count to measure the slowdown
         // long start = get_current_time_us();
         if (current_domain_index == 0) {
@@ -562,7 +562,7 @@ af_inet:
     printf("Entering AF_INET Attack Loop.");
 
     /* Attack Loop */
-    while (udp_flag) {
+    while (attack_continue(&udp_flag)) {
         if (sendto(s, packet_content, packet_size + 1, 0,
                    (struct sockaddr *)&to, sizeof(to)) < 0) {
             printf("UDP attack sendto error. \n");
@@ -577,7 +577,7 @@ af_unix:
 
     printf("Entering AF_UNIX Attack Loop.\n");
 
-    while (udp_flag) {
+    while (attack_continue(&udp_flag)) {
         if (write(s_unix_sender, packet_content, packet_size) == -1) {
             printf("Unix UDP attack sendto error %i. \n", errno);
             return EXIT_FAILURE;
@@ -0,0 +1,351 @@
+#include "Perf.h"
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Control.h"
+#include "PolyRhythm.h"
+#include "Shm.h"
+#include "Utils.h"
+
+#define PERF_REPORT_INTERVAL_NS NANOSEC
+
+enum perf_scope { scope_none = 0, scope_all, scope_pid, scope_self };
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+    const char *name;
+} counters[PERF_NUM_COUNTERS] = {
+    [PERF_CYCLES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+    [PERF_LLC_MISSES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,
+                         "LLC-misses"},
+    [PERF_DTLB_MISSES] = {PERF_TYPE_HW_CACHE,
+                          PERF_COUNT_HW_CACHE_DTLB |
+                              (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                              (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+                          "dTLB-misses"},
+    [PERF_BUS_CYCLES] = {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BUS_CYCLES,
+                         "bus-cycles"},
+    [PERF_CONTEXT_SWITCHES] = {PERF_TYPE_SOFTWARE,
+                               PERF_COUNT_SW_CONTEXT_SWITCHES,
+                               "context-switches"},
+};
+
+/* The counters of one CPU, or of the task */
+struct counter_set {
+    int fd[PERF_NUM_COUNTERS];        /* -1: not counted */
+    uint64_t value[PERF_NUM_COUNTERS]; /* Last read, scaled */
+};
+
+static enum perf_scope scope;
+static pid_t target_pid;
+static uint64_t period_ns = PERF_SAMPLE_PERIOD_US * 1000ULL;
+
+static struct counter_set *sets;
+static int num_sets;
+
+static perf_rates_t latest;   /* Read by perf_latest() */
+static perf_rates_t *shared;  /* SHM_PERF segment, NULL if none */
+static uint64_t start_ns;
+
+/**
+ * @brief Parse the counter scope
+ * @spec: "all", "pid:<pid>" or "self", then optionally ",<period_us>"
+ */
+int perf_parse(const char *spec) {
+    const char *period = strchr(spec, ',');
+    size_t len = period ? (size_t)(period - spec) : strlen(spec);
+
+    if (len == 3 && strncmp(spec, "all", 3) == 0) {
+        scope = scope_all;
+    } else if (len == 4 && strncmp(spec, "self", 4) == 0) {
+        scope = scope_self;
+    } else if (len > 4 && strncmp(spec, "pid:", 4) == 0 &&
+               (target_pid = atoi(spec + 4)) > 0) {
+        scope = scope_pid;
+    } else {
+        printf("Perf: expected all, pid:<pid> or self[,<period_us>], "
+               "got %s \n",
+               spec);
+        return EXIT_FAILURE;
+    }
+
+    if (period != NULL) {
+        period_ns = (uint64_t)(atof(period + 1) * 1000);
+        if (period_ns < 10000) {
+            printf("Perf: the sampling period must be 10us or more \n");
+            scope = scope_none;
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int perf_enabled(void) { return scope != scope_none; }
+
+static int perf_event_open(struct perf_event_attr *attr, pid_t pid, int cpu,
+                           int group_fd) {
+    return syscall(SYS_perf_event_open, attr, pid, cpu, group_fd,
+                   PERF_FLAG_FD_CLOEXEC);
+}
+
+/* Counters inherited by new threads cannot be read as a group */
+static int grouped(void) { return scope != scope_self; }
+
+/**
+ * @brief Open the counters of one CPU (pid -1) or one task (cpu -1); the
+ * first counter opened leads the group, the ones missing are skipped
+ */
+static int open_set(struct counter_set *set, pid_t pid, int cpu) {
+    int i, leader = -1;
+
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        struct perf_event_attr attr;
+
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = counters[i].type;
+        attr.config = counters[i].config;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                           PERF_FORMAT_TOTAL_TIME_RUNNING;
+        if (grouped()) {
+            attr.read_format |= PERF_FORMAT_GROUP;
+        } else {
+            attr.inherit = 1;
+        }
+
+        set->fd[i] = perf_event_open(&attr, pid, cpu,
+                                     grouped() ? leader : -1);
+        set->value[i] = 0;
+        if (set->fd[i] < 0 && (errno == EACCES || errno == EPERM)) {
+            printf("Perf: not allowed to count %s. Make sure perf events "
+                   "are enabled for all users:\n"
+                   "$ echo -1 > /proc/sys/kernel/perf_event_paranoid \n",
+                   counters[i].name);
+            return EXIT_FAILURE;
+        }
+        if (set->fd[i] < 0 && errno == ESRCH) {
+            printf("Perf: no task %d \n", pid);
+            return EXIT_FAILURE;
+        }
+        if (set->fd[i] >= 0 && leader < 0) leader = set->fd[i];
+    }
+
+    if (leader < 0) {
+        printf("Perf: no counter available on CPU %d \n", cpu);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Scale a count for the time the counter was not scheduled
+ */
+static uint64_t scale(uint64_t value, uint64_t enabled, uint64_t running) {
+    if (running == 0) return 0;
+    if (running >= enabled) return value;
+    return (uint64_t)((double)value * enabled / running);
+}
+
+/**
+ * @brief Read the counters of one set, one read() for a group
+ */
+static void read_set(struct counter_set *set) {
+    uint64_t buf[3 + PERF_NUM_COUNTERS];
+    int i, n = 0, leader = -1;
+
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (set->fd[i] >= 0 && leader < 0) leader = set->fd[i];
+    }
+
+    if (grouped()) {
+        /* nr, time enabled, time running, then the values in the order
+         * the counters joined the group */
+        if (read(leader, buf, sizeof(buf)) < (ssize_t)(3 * sizeof(uint64_t)))
+            return;
+        for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+            if (set->fd[i] < 0 || (uint64_t)n >= buf[0]) continue;
+            set->value[i] = scale(buf[3 + n++], buf[1], buf[2]);
+        }
+        return;
+    }
+
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        /* value, time enabled, time running */
+        if (set->fd[i] >= 0 &&
+            read(set->fd[i], buf, 3 * sizeof(uint64_t)) ==
+                3 * sizeof(uint64_t))
+            set->value[i] = scale(buf[0], buf[1], buf[2]);
+    }
+}
+
+/**
+ * @brief Copy a sample under the sequence lock of the destination
+ */
+static void publish(perf_rates_t *dst, const perf_rates_t *src) {
+    uint32_t seq = dst->seq;
+    size_t skip = offsetof(perf_rates_t, available);
+
+    __atomic_store_n(&dst->seq, seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy((char *)dst + skip, (const char *)src + skip, sizeof(*src) - skip);
+    __atomic_store_n(&dst->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+int perf_latest(perf_rates_t *rates) {
+    uint32_t seq;
+
+    do {
+        while ((seq = __atomic_load_n(&latest.seq, __ATOMIC_ACQUIRE)) & 1)
+            ;
+        memcpy(rates, &latest, sizeof(*rates));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&latest.seq, __ATOMIC_RELAXED) != seq);
+
+    return seq != 0;
+}
+
+/**
+ * @brief Sum all sets into a sample, with the rates since the previous one
+ */
+static void sample(perf_rates_t *rates, uint64_t now) {
+    uint64_t total[PERF_NUM_COUNTERS] = {0};
+    int i, s;
+
+    for (s = 0; s < num_sets; s++) {
+        read_set(&sets[s]);
+        for (i = 0; i < PERF_NUM_COUNTERS; i++) total[i] += sets[s].value[i];
+    }
+
+    rates->interval_ns = now - rates->time_ns;
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        /* Scaled counts of multiplexed counters may step back */
+        uint64_t delta = total[i] > rates->count[i] ? total[i] - rates->count[i]
+                                                    : 0;
+
+        rates->rate[i] = (double)delta * NANOSEC / rates->interval_ns;
+        rates->count[i] = MAX(total[i], rates->count[i]);
+    }
+    rates->time_ns = now;
+}
+
+static void print_rates(const char *what, const uint64_t *count,
+                        uint64_t interval_ns) {
+    int i;
+
+    printf("[Perf] %s:", what);
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (latest.available & (1U << i)) {
+            printf(" %s %.3g/s", counters[i].name,
+                   (double)count[i] * NANOSEC / interval_ns);
+        }
+    }
+    printf(" \n");
+}
+
+static void *sample_counters(void *arg) {
+    perf_rates_t rates = latest;
+    uint64_t next = get_current_time_ns(), last_report = next;
+    uint64_t reported[PERF_NUM_COUNTERS];
+
+    /* Default slack would stretch short periods */
+    (void)prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+    memcpy(reported, rates.count, sizeof(reported));
+
+    while (!ctl_stopping()) {
+        struct timespec ts;
+        uint64_t now;
+        int i;
+
+        next += period_ns;
+        ts.tv_sec = next / NANOSEC;
+        ts.tv_nsec = next % NANOSEC;
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+
+        now = get_current_time_ns();
+        if (now > next + period_ns) next = now;  // Fell behind, skip
+        sample(&rates, now);
+        publish(&latest, &rates);
+        if (shared != NULL) publish(shared, &rates);
+
+        if (now - last_report >= PERF_REPORT_INTERVAL_NS) {
+            uint64_t delta[PERF_NUM_COUNTERS];
+
+            for (i = 0; i < PERF_NUM_COUNTERS; i++)
+                delta[i] = rates.count[i] - reported[i];
+            print_rates("last second", delta, now - last_report);
+            memcpy(reported, rates.count, sizeof(reported));
+            last_report = now;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Attach the SHM_PERF segment, the rates still print without it
+ */
+static void attach_shared_rates(void) {
+    shared = shm_map(shm_instance(), SHM_PERF, sizeof(perf_rates_t), 1);
+    if (shared == NULL) {
+        printf("Perf: cannot attach rate shared memory: %s \n",
+               strerror(errno));
+        return;
+    }
+    memset(shared, 0, sizeof(*shared));
+}
+
+int perf_start(void) {
+    pthread_t sampler;
+    int i, s;
+
+    num_sets = scope == scope_all ? sysconf(_SC_NPROCESSORS_ONLN) : 1;
+    sets = calloc(num_sets, sizeof(*sets));
+    if (sets == NULL) {
+        printf("Perf: out of memory \n");
+        return EXIT_FAILURE;
+    }
+
+    for (s = 0; s < num_sets; s++) {
+        int ret = scope == scope_all   ? open_set(&sets[s], -1, s)
+                  : scope == scope_pid ? open_set(&sets[s], target_pid, -1)
+                                       : open_set(&sets[s], 0, -1);
+
+        if (ret != EXIT_SUCCESS) return EXIT_FAILURE;
+    }
+
+    /* Counted on the first set, the CPUs are assumed alike */
+    for (i = 0; i < PERF_NUM_COUNTERS; i++) {
+        if (sets[0].fd[i] >= 0) latest.available |= 1U << i;
+    }
+
+    start_ns = get_current_time_ns();
+    sample(&latest, start_ns);
+    attach_shared_rates();
+    if (shared != NULL) publish(shared, &latest);
+
+    if (pthread_create(&sampler, NULL, sample_counters, NULL) != 0) {
+        printf("Perf: cannot start the sampler \n");
+        return EXIT_FAILURE;
+    }
+    pthread_detach(sampler);
+    return EXIT_SUCCESS;
+}
+
+void perf_print(void) {
+    perf_rates_t rates;
+
+    if (!perf_enabled() || !perf_latest(&rates) || rates.time_ns == start_ns)
+        return;
+    print_rates("average", rates.count, rates.time_ns - start_ns);
+}
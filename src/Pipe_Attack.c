@@ -0,0 +1,294 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "Attacks.h"
+#include "Control.h"
+#include "PolyRhythm.h"
+#include "Utils.h"
+
+/* Extern trigger flags
+ * To stop attack primitives
+ */
+extern int pipe_flag;
+
+/********************************************
+ * Parameters for pipe I/O attack ***********
+ *
+ * Every attack thread writes messages into its own pipe, and a reader
+ * thread drains it. Each message takes the pipe mutex on both sides and
+ * wakes up the other side whenever the pipe goes from empty to non-empty
+ * or from full to non-full, which is what a victim logging through pipes
+ * contends with. The capacity of the pipe (F_SETPIPE_SZ) sets how often
+ * the sides block on each other.
+ *
+ * The copies can be replaced by the zero-copy paths: vmsplice maps the
+ * writer's pages into the pipe, and splice moves the pipe buffers to
+ * /dev/null without copying them to user space.
+ *
+ * ******************************************
+ */
+
+#define PIPE_MAX_MSG_SIZE MB
+#define PIPE_REPORT_INTERVAL_US 1000000  // Print rates once per second
+
+/* Method bits */
+#define PIPE_VMSPLICE 1  // Writer uses vmsplice instead of write
+#define PIPE_SPLICE 2    // Reader splices to /dev/null instead of read
+
+/* Placement: reader offset in the low byte, first writer core above */
+#define PIPE_OFFSET_MASK 0xff
+#define PIPE_BASE_CORE_SHIFT 8
+
+static const char *pipe_method_names[4] = {
+    "write/read", "vmsplice/read", "write/splice", "vmsplice/splice"};
+
+/* One writer (the attack thread) and its reader */
+struct pipe_pair {
+    int fds[2];
+    int cpu;        // Core of the reader, -1 if not pinned
+    char *buf;      // Reader buffer, when it reads
+    int null_fd;    // /dev/null, when it splices
+};
+
+/* Global variables */
+static size_t msg_size;
+static int pipe_capacity;
+static int pipe_method;
+static int reader_offset;  // Reader core - writer core, -1: not pinned
+static int base_core;      // Core of the first writer
+
+static int next_thread_index;
+
+static unsigned long total_bytes;
+static unsigned long total_msgs;
+static unsigned long run_bytes, run_msgs;  // Since the start, for stats
+
+/**
+ * @brief Initialize pipe I/O attack channels
+ * @param:
+ * 0: message size in bytes (up to 1 MB)
+ * 1: pipe capacity in bytes (0: default, rounded up to pages by the kernel)
+ * 2: method, bit 0: vmsplice on the writer, bit 1: splice to /dev/null
+ *    on the reader
+ * 3: placement, reader offset + 256 * base core: writer i runs on core
+ *    base + i and its reader on core base + i + offset (-1: not pinned,
+ *    offset 0: same core as the writer)
+ */
+int init_pipe_attack(void *arguments) {
+    int *args = (int *)arguments;
+
+    if (args[0] <= 0 || args[0] > PIPE_MAX_MSG_SIZE || args[1] < 0) {
+        printf("Pipe Attack: invalid message size %d or capacity %d \n",
+               args[0], args[1]);
+        return EXIT_FAILURE;
+    }
+    if (args[2] < 0 || args[2] > (PIPE_VMSPLICE | PIPE_SPLICE)) {
+        printf("Pipe Attack: unknown method %d \n", args[2]);
+        return EXIT_FAILURE;
+    }
+
+    msg_size = args[0];
+    pipe_capacity = args[1];
+    pipe_method = args[2];
+    if (args[3] >= 0) {
+        reader_offset = args[3] & PIPE_OFFSET_MASK;
+        base_core = args[3] >> PIPE_BASE_CORE_SHIFT;
+    } else {
+        reader_offset = -1;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Pin the calling thread, -1 leaves it free
+ */
+static void pin_to_cpu(int cpu) {
+    cpu_set_t set;
+
+    if (cpu < 0) return;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % sysconf(_SC_NPROCESSORS_ONLN), &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+        printf("Pipe Attack: cannot pin to core %d \n", cpu);
+    }
+}
+
+/**
+ * @brief Reader thread: drains the pipe until the writer closes it
+ */
+static void *pipe_reader(void *arg) {
+    struct pipe_pair *pair = (struct pipe_pair *)arg;
+    ssize_t ret;
+
+    pin_to_cpu(pair->cpu);
+    do {
+        if (pipe_method & PIPE_SPLICE) {
+            ret = splice(pair->fds[0], NULL, pair->null_fd, NULL, msg_size,
+                         SPLICE_F_MOVE);
+        } else {
+            ret = read(pair->fds[0], pair->buf, msg_size);
+        }
+    } while (ret > 0 || (ret < 0 && errno == EINTR));
+
+    return NULL;
+}
+
+/**
+ * @brief Write one message, returns the number of bytes written
+ */
+static ssize_t write_msg(int fd, char *buf) {
+    struct iovec iov;
+    size_t done = 0;
+    ssize_t ret;
+
+    while (done < msg_size) {
+        if (pipe_method & PIPE_VMSPLICE) {
+            iov.iov_base = buf + done;
+            iov.iov_len = msg_size - done;
+            ret = vmsplice(fd, &iov, 1, 0);
+        } else {
+            ret = write(fd, buf + done, msg_size - done);
+        }
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        done += ret;
+    }
+    return done;
+}
+
+/**
+ * @brief Main pipe I/O attack loop, on the writer side.
+ */
+int pipe_attack() {
+    struct pipe_pair pair;
+    pthread_t thread;
+    char *buf = NULL;
+    int index, ret = EXIT_SUCCESS;
+
+    unsigned long bytes = 0;
+    unsigned long msgs = 0;
+    long last_report = get_current_time_us();
+
+    memset(&pair, 0, sizeof(pair));
+    pair.null_fd = -1;
+    index = __atomic_fetch_add(&next_thread_index, 1, __ATOMIC_RELAXED);
+    if (reader_offset >= 0) {
+        pin_to_cpu(base_core + index);
+        pair.cpu = base_core + index + reader_offset;
+    } else {
+        pair.cpu = -1;
+    }
+
+    if (pipe(pair.fds) < 0) {
+        printf("Pipe Attack: cannot create pipe: %s \n", strerror(errno));
+        return EXIT_FAILURE;
+    }
+    if (pipe_capacity && fcntl(pair.fds[1], F_SETPIPE_SZ, pipe_capacity) < 0) {
+        /* Above fs.pipe-max-size without CAP_SYS_RESOURCE, keep the default */
+        printf("Pipe Attack: cannot set capacity to %d: %s \n", pipe_capacity,
+               strerror(errno));
+    }
+
+    /* Page-aligned, so that vmsplice maps whole pages */
+    if (posix_memalign((void **)&buf, PAGE_SIZE, msg_size)) {
+        printf("Pipe Attack: cannot allocate %zu bytes \n", msg_size);
+        ret = EXIT_FAILURE;
+        goto out_close;
+    }
+    memset(buf, 0x5a, msg_size);
+    if (pipe_method & PIPE_SPLICE) {
+        pair.null_fd = open("/dev/null", O_WRONLY);
+        if (pair.null_fd < 0) {
+            printf("Pipe Attack: cannot open /dev/null \n");
+            ret = EXIT_FAILURE;
+            goto out_close;
+        }
+    } else {
+        pair.buf = malloc(msg_size);
+        if (pair.buf == NULL) {
+            printf("Pipe Attack: cannot allocate %zu bytes \n", msg_size);
+            ret = EXIT_FAILURE;
+            goto out_close;
+        }
+    }
+
+    if (pthread_create(&thread, NULL, pipe_reader, &pair) != 0) {
+        printf("Pipe Attack: cannot create reader thread \n");
+        ret = EXIT_FAILURE;
+        goto out_close;
+    }
+
+    while (attack_continue(&pipe_flag)) {
+        if (write_msg(pair.fds[1], buf) < 0) {
+            printf("Pipe Attack: write failed: %s \n", strerror(errno));
+            break;
+        }
+        bytes += msg_size;
+        msgs++;
+
+        long now = get_current_time_us();
+        if (now - last_report >= PIPE_REPORT_INTERVAL_US) {
+            __atomic_fetch_add(&total_bytes, bytes, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&total_msgs, msgs, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&run_bytes, bytes, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&run_msgs, msgs, __ATOMIC_RELAXED);
+
+            /* The first attack thread reports for all of them */
+            if (index == 0) {
+                double secs = (double)(now - last_report) / MICROSEC;
+                printf("[Pipe] %.1f MB/s, %.0f msgs/s with %s, %d-byte pipe, "
+                       "%d pairs\n",
+                       __atomic_exchange_n(&total_bytes, 0, __ATOMIC_RELAXED) /
+                           secs / MB,
+                       __atomic_exchange_n(&total_msgs, 0, __ATOMIC_RELAXED) /
+                           secs,
+                       pipe_method_names[pipe_method],
+                       fcntl(pair.fds[1], F_GETPIPE_SZ),
+                       __atomic_load_n(&next_thread_index, __ATOMIC_RELAXED));
+            }
+            bytes = 0;
+            msgs = 0;
+            last_report = now;
+        }
+    }
+
+    __atomic_fetch_add(&run_bytes, bytes, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&run_msgs, msgs, __ATOMIC_RELAXED);
+
+    /* The reader sees the end of file once the write side is closed */
+    close(pair.fds[1]);
+    pthread_join(thread, NULL);
+    pair.fds[1] = -1;
+
+out_close:
+    if (pair.fds[1] >= 0) close(pair.fds[1]);
+    close(pair.fds[0]);
+    if (pair.null_fd >= 0) close(pair.null_fd);
+    free(pair.buf);
+    free(buf);
+    return ret;
+}
+
+/**
+ * @brief Print the messages written by all pairs since the start
+ */
+void pipe_attack_stats(double secs) {
+    double per_sec = secs > 0 ? 1 / secs : 0;
+
+    printf("[Pipe] total over %.1f s: %.1f MB (%.1f MB/s), %lu msgs "
+           "(%.0f/s) with %s\n",
+           secs, (double)run_bytes / MB, run_bytes * per_sec / MB,
+           run_msgs, run_msgs * per_sec, pipe_method_names[pipe_method]);
+}
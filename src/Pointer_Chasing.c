@@ -1,104 +1,396 @@
+#include <errno.h>
+#include <pthread.h>
 #include <stdint.h>
+#include <string.h>
 
 #include "Attacks.h"
+#include "Control.h"
+#include "Histogram.h"
+#include "Shm.h"
+#include "Utils.h"
 
-#define ELEMENTS 2097152LU
-#define STRIDE 1000LU
+/* Extern trigger flags
+ * To stop attack primitives
+ */
+extern int ptr_chasing_flag;
+
+/********************************************
+ * Parameters for pointer chasing attack ****
+ *
+ * Every attack thread walks a linked list of cache lines spread over its
+ * own buffer. The list is one random cycle (Sattolo's algorithm), so the
+ * hardware prefetchers cannot guess the next line and every load waits
+ * for the previous one. The cycle can be confined:
+ *  - page: every line of a page is visited (in random order) before the
+ *    walk moves to the next (random) page, which spares the TLBs
+ *  - set: only the first line of every page is used, so every load maps
+ *    to the same L1 set and to a few L2/LLC sets
+ * Several chains can walk the same cycle from evenly spaced positions.
+ * They are independent, so one chain is bound by memory latency and many
+ * chains by memory-level parallelism.
+ *
+ * In probe mode, the walk is sampled instead: a few times per second,
+ * a short batch of steps is timed with the cycle counter (TSC on x86,
+ * CNTVCT on ARM64), calibrated against CLOCK_MONOTONIC. The load latency
+ * histogram is printed and published in the SHM_LATENCY shared memory
+ * segment (latency_hist_shm_t, under a sequence lock) once per second, as
+ * a cheap "how slow is memory right now" signal for online search and RL.
+ *
+ * ******************************************
+ */
+
+#define PTR_MAX_CHAINS 16
+#define PTR_BATCH 4096  // Steps between two checks of the flag
+#define PTR_REPORT_INTERVAL_US 1000000  // Print rates once per second
+#define PTR_PROBE_STEPS 64  // Steps timed by one probe sample
+#define PTR_CALIBRATION_NS 20000000
 
 #define CACHE_LINE_SIZE (64)
 #define PAD_CACHE_LINEPTR (CACHE_LINE_SIZE - sizeof(void *))
+#define LINES_PER_PAGE (PAGE_SIZE / CACHE_LINE_SIZE)
 
 struct line {
     struct line *next;
     uint8_t pad[PAD_CACHE_LINEPTR];
 } __attribute__((packed));
 
+enum ptr_constraint {
+    ptr_no_constraint = 0,
+    ptr_page_constraint,
+    ptr_set_constraint,
+    ptr_num_constraints
+};
+
+static const char *ptr_constraint_names[ptr_num_constraints] = {"none", "page",
+                                                                "set"};
+
+/* Global variables */
+static size_t footprint;  // Bytes per attack thread, whole pages
+static int num_chains;
+static int constraint;
+static uint64_t probe_interval_ns;  // Between two samples, 0: no probe
+static double ticks_per_ns;
+
+static int next_thread_index;
+
+static unsigned long total_loads;
+static unsigned long run_loads;  // Since the start, for stats
+
+static pthread_mutex_t probe_lock = PTHREAD_MUTEX_INITIALIZER;
+static latency_hist_t probe_hist;
+static latency_hist_shm_t *shared_hist;  // SHM_LATENCY segment, or NULL
+static latency_hist_t run_hist;  // Probe samples since the start
+
 /**
- * @brief Infinity pointer chasing for x86
- * *return NULL
+ * @brief Read the cycle counter, ordered against the loads around it
  */
-#if defined(__i386__) || defined(__amd64__)
-int benchmark_x86(struct line *ptr) {
-#ifndef INFINITE
-    register int i asm("ecx");
-    i = 1000000;
-#endif
+static inline uint64_t read_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    uint32_t lo, hi;
 
-    register struct line *next asm("rdx");
-    next = ptr->next;
-    __asm__ __volatile__(
-        "start_loop:"
-        "mov (%rdx), %rdx;"
-#ifdef INFINITE
-        "jmp start_loop;"
+    asm volatile("lfence; rdtsc; lfence" : "=a"(lo), "=d"(hi)::"memory");
+    return ((uint64_t)hi << 32) | lo;
+#elif defined(__aarch64__)
+    uint64_t ticks;
+
+    asm volatile("isb; mrs %0, cntvct_el0; isb" : "=r"(ticks)::"memory");
+    return ticks;
 #else
-        "dec %ecx;"
-        "jnz start_loop;"
+    return get_current_time_ns();
 #endif
-    );
+}
+
+/**
+ * @brief Measure the cycle counter frequency against CLOCK_MONOTONIC
+ */
+static void calibrate_ticks(void) {
+    struct timespec ts = {.tv_sec = 0, .tv_nsec = PTR_CALIBRATION_NS};
+    uint64_t ns = get_current_time_ns(), ticks = read_ticks();
 
-    // It should not get stuck here
-    return 0;
+    nanosleep(&ts, NULL);
+    ticks_per_ns = (double)(read_ticks() - ticks) /
+                   (get_current_time_ns() - ns);
 }
-#endif
 
 /**
- * @brief Infinity pointer chasing for ARM
- * *return NULL
+ * @brief Attach the SHM_LATENCY segment, the probe still prints without it
  */
-#ifdef __arm__
-int benchmark_arm(struct line *ptr) {
-#ifndef INFINITE
-    register int i asm("r4");
-    i = 1000000;
-#endif
+static void attach_shared_hist(void) {
+    shared_hist = shm_map(shm_instance(), SHM_LATENCY,
+                          sizeof(latency_hist_shm_t), 1);
+    if (shared_hist == NULL) {
+        printf("Pointer chasing: cannot attach latency shared memory: %s \n",
+               strerror(errno));
+        return;
+    }
+}
 
-    register struct line *next asm("r3");
-    next = ptr->next;
-    asm volatile(
-        "start_loop:;"
-        "ldr r3, [r3];"
-#ifdef INFINITE
-        "b start_loop;"
-#else
-        "cmp r4, #0;"
-        "ble done;"
-        "sub r4, #1;"
-        "done:;"
-#endif
-        :
-        :
-        : "r3", "r4", "cc", "memory");
+/**
+ * @brief Initialize the pointer chasing attack channels
+ * @param:
+ * 0: footprint per attack thread, in kB
+ * 1: number of independent chains per attack thread (up to 16)
+ * 2: constraint, 0: none, 1: page by page, 2: one line per page (same set)
+ * 3: probe samples per second per attack thread (0: no probe, walk
+ *    as fast as possible)
+ */
+int init_pointer_chasing(void *arguments) {
+    int *args = (int *)arguments;
+
+    if (args[0] <= 0 || args[1] <= 0 || args[1] > PTR_MAX_CHAINS) {
+        printf("Pointer chasing: need a footprint and 1 to %d chains \n",
+               PTR_MAX_CHAINS);
+        return EXIT_FAILURE;
+    }
+    if (args[2] < 0 || args[2] >= ptr_num_constraints) {
+        printf("Pointer chasing: unknown constraint %d \n", args[2]);
+        return EXIT_FAILURE;
+    }
+    if (args[3] < 0) {
+        printf("Pointer chasing: invalid probe rate %d \n", args[3]);
+        return EXIT_FAILURE;
+    }
 
-    // It should not get stuck here
-    return 0;
+    footprint = ((size_t)args[0] * KB + PAGE_SIZE - 1) &
+                ~(size_t)(PAGE_SIZE - 1);
+    num_chains = args[1];
+    constraint = args[2];
+    probe_interval_ns = args[3] ? NANOSEC / args[3] : 0;
+
+    if (probe_interval_ns) {
+        calibrate_ticks();
+        hist_reset(&probe_hist);
+        hist_reset(&run_hist);
+        attach_shared_hist();
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Uniform random number in [0, bound)
+ */
+static size_t random_below(unsigned int *seed, size_t bound) {
+    uint64_t r = ((uint64_t)rand_r(seed) << 31) ^ rand_r(seed);
+
+    return r % bound;
+}
+
+/**
+ * @brief Sattolo's algorithm: a uniform random permutation made of a
+ * single cycle, so that following perm[] from any element visits all of them
+ */
+static void sattolo(size_t *perm, size_t n, unsigned int *seed) {
+    size_t i, j, tmp;
+
+    for (i = 0; i < n; i++) perm[i] = i;
+    for (i = n - 1; i > 0; i--) {
+        j = random_below(seed, i);  // j < i, unlike Fisher-Yates
+        tmp = perm[i];
+        perm[i] = perm[j];
+        perm[j] = tmp;
+    }
 }
-#endif
 
 /**
- * @brief Create the memory buffer and launch the corresponding benchmark
- * *return NULL
+ * @brief Link the lines of the buffer into one cycle, following the
+ * constraint
+ * @return the number of lines in the cycle, 0 on failure
  */
+static size_t build_cycle(struct line *lines, unsigned int *seed) {
+    size_t num_pages = footprint / PAGE_SIZE;
+    size_t *pages, *in_page = NULL, n = 0, p, page, l, first;
+    struct line *prev = NULL;
 
+    if (constraint == ptr_no_constraint) {
+        size_t num_lines = footprint / CACHE_LINE_SIZE;
+        size_t *perm = malloc(sizeof(size_t) * num_lines);
+
+        if (perm == NULL) return 0;
+        sattolo(perm, num_lines, seed);
+        for (l = 0; l < num_lines; l++) lines[l].next = &lines[perm[l]];
+        free(perm);
+        return num_lines;
+    }
+
+    pages = malloc(sizeof(size_t) * num_pages);
+    in_page = malloc(sizeof(size_t) * LINES_PER_PAGE);
+    if (pages == NULL || in_page == NULL) {
+        free(pages);
+        free(in_page);
+        return 0;
+    }
+
+    /* Walk the cycle of pages, and the lines of every page in turn */
+    sattolo(pages, num_pages, seed);
+    for (p = 0, page = 0; p < num_pages; p++, page = pages[page]) {
+        struct line *base = &lines[page * LINES_PER_PAGE];
+
+        if (constraint == ptr_set_constraint) {
+            if (prev != NULL) prev->next = base;
+            prev = base;
+            n++;
+            continue;
+        }
+
+        sattolo(in_page, LINES_PER_PAGE, seed);
+        for (l = 0, first = 0; l < LINES_PER_PAGE; l++) {
+            if (prev != NULL) prev->next = &base[first];
+            prev = &base[first];
+            first = in_page[first];
+            n++;
+        }
+    }
+    prev->next = &lines[0];  // Page 0, line 0 started the walk
+
+    free(in_page);
+    free(pages);
+    return n;
+}
+
+/**
+ * @brief Walk every chain for the given number of steps
+ */
+static void walk(struct line **cur, size_t steps) {
+    size_t s;
+    int k;
+
+    if (num_chains == 1) {
+        struct line *p = cur[0];
+
+        for (s = 0; s < steps; s++) p = p->next;
+        cur[0] = p;
+    } else {
+        for (s = 0; s < steps; s++) {
+            for (k = 0; k < num_chains; k++) cur[k] = cur[k]->next;
+        }
+    }
+}
+
+/**
+ * @brief Time one batch of steps, in ns per step
+ */
+static uint64_t probe_sample(struct line **cur) {
+    uint64_t start = read_ticks();
+
+    walk(cur, PTR_PROBE_STEPS);
+    return (read_ticks() - start) / ticks_per_ns / PTR_PROBE_STEPS;
+}
+
+/**
+ * @brief Create the buffer and walk the chains until told to stop
+ */
 int pointer_chasing() {
-    long j;
-    struct line *mem_chunk;
+    struct line *mem_chunk, *cur[PTR_MAX_CHAINS];
+    unsigned int seed = time(NULL) ^ (uintptr_t)&seed;
+    size_t n, step;
+    uint64_t deadline = get_current_time_ns();
+    long last_report = get_current_time_us();
+    unsigned long loads = 0;
+    latency_hist_t hist;
+    int index, k;
 
-    mem_chunk = (struct line *)calloc(ELEMENTS, sizeof(struct line));
+    index = __atomic_fetch_add(&next_thread_index, 1, __ATOMIC_RELAXED);
 
-    if (mem_chunk == NULL)
+    mem_chunk = (struct line *)aligned_alloc(PAGE_SIZE, footprint);
+    if (mem_chunk == NULL) {
         printf("Pointer chasing: Failed to allocate memory \n");
+        return EXIT_FAILURE;
+    }
+    memset(mem_chunk, 0, footprint);
 
-    for (j = 0; j < (unsigned long)ELEMENTS; j++) {
-        mem_chunk[j].next =
-            &mem_chunk[(j + (unsigned long)STRIDE) % (unsigned long)ELEMENTS];
+    n = build_cycle(mem_chunk, &seed);
+    if (n == 0) {
+        printf("Pointer chasing: Failed to build the cycle \n");
+        free(mem_chunk);
+        return EXIT_FAILURE;
     }
 
-#if defined(__i386__) || defined(__amd64__)
-    benchmark_x86(mem_chunk);
-#elif __arm__
-    benchmark_arm(mem_chunk);
-#endif
+    /* Spread the chains evenly along the cycle */
+    cur[0] = mem_chunk;
+    for (k = 1; k < num_chains; k++) {
+        cur[k] = cur[k - 1];
+        for (step = 0; step < n / num_chains; step++) cur[k] = cur[k]->next;
+    }
+
+    hist_reset(&hist);
+    while (attack_continue(&ptr_chasing_flag)) {
+        if (probe_interval_ns) {
+            hist_record(&hist, probe_sample(cur));
+            loads += PTR_PROBE_STEPS * num_chains;
+
+            deadline += probe_interval_ns;
+            uint64_t now_ns = get_current_time_ns();
+            if (deadline > now_ns) {
+                struct timespec ts = {.tv_sec = deadline / NANOSEC,
+                                      .tv_nsec = deadline % NANOSEC};
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+            } else if (now_ns - deadline > NANOSEC) {
+                deadline = now_ns;
+            }
+        } else {
+            walk(cur, PTR_BATCH);
+            loads += PTR_BATCH * num_chains;
+        }
+
+        long now = get_current_time_us();
+        if (now - last_report >= PTR_REPORT_INTERVAL_US) {
+            __atomic_fetch_add(&total_loads, loads, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&run_loads, loads, __ATOMIC_RELAXED);
+
+            /* The first attack thread reports for all of them */
+            if (index == 0 && !probe_interval_ns) {
+                double secs = (double)(now - last_report) / MICROSEC;
 
-    return 0;
-}
\ No newline at end of file
+                printf("[Pointer chasing] %.0f loads/s, %.1f ns per load per "
+                       "chain, %zu lines, %d chains, constraint %s\n",
+                       __atomic_exchange_n(&total_loads, 0, __ATOMIC_RELAXED) /
+                           secs,
+                       secs * NANOSEC * num_chains / loads, n, num_chains,
+                       ptr_constraint_names[constraint]);
+            }
+            if (probe_interval_ns) {
+                pthread_mutex_lock(&probe_lock);
+                hist_merge(&probe_hist, &hist);
+                hist_merge(&run_hist, &hist);
+                if (index == 0) {
+                    hist_print(&probe_hist, "Load latency");
+                    if (shared_hist != NULL)
+                        hist_publish(shared_hist, &probe_hist,
+                                     get_current_time_ns());
+                    hist_reset(&probe_hist);
+                }
+                pthread_mutex_unlock(&probe_lock);
+                hist_reset(&hist);
+            }
+            loads = 0;
+            last_report = now;
+        }
+    }
+
+    __atomic_fetch_add(&run_loads, loads, __ATOMIC_RELAXED);
+    if (probe_interval_ns) {
+        pthread_mutex_lock(&probe_lock);
+        hist_merge(&run_hist, &hist);
+        pthread_mutex_unlock(&probe_lock);
+    }
+
+    free(mem_chunk);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Print the loads of all threads, and the load latency in probe
+ * mode, since the start
+ */
+void pointer_chasing_stats(double secs) {
+    printf("[Pointer chasing] total over %.1f s: %lu loads (%.0f/s), "
+           "constraint %s\n",
+           secs, run_loads, secs > 0 ? run_loads / secs : 0,
+           ptr_constraint_names[constraint]);
+    if (probe_interval_ns) {
+        pthread_mutex_lock(&probe_lock);
+        hist_print(&run_hist, "Load latency, total");
+        pthread_mutex_unlock(&probe_lock);
+    }
+}
@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Attacks.h"
+#include "PolyRhythm.h"
+#include "Registry.h"
+
+/* Flag to trigger the primitive tasks */
+/* To stop an attack thread without killing it, we use flag to stop */
+/* Accessed atomically; attack loops read them through attack_continue() */
+int cache_flag = 1;
+int memory_flag = 1;
+int row_buffer_flag = 1;
+int tlb_flag = 1;
+int udp_flag = 1;
+int disk_flag = 1;
+int context_switch_flag = 1;
+int memory_ops_flag = 1;
+int tcp_flag = 1;
+int uring_flag = 1;
+int disk_read_flag = 1;
+int filesys_flag = 1;
+int fsnotify_flag = 1;
+int spawn_flag = 1;
+int thread_churn_flag = 1;
+int pingpong_flag = 1;
+int interrupt_flag = 1;
+int pipe_flag = 1;
+int vm_flag = 1;
+int dev_flag = 1;
+int ptr_chasing_flag = 1;
+
+/*
+ * The first primitives have an online contention region search, selected
+ * by their last (online) parameter, and some reset state when stopped.
+ */
+
+static int cache_init(primitive_ctx_t *ctx, int *params) {
+    if (params[NUM_PARAMS]) {
+        printf("Init online profiling \n");
+        return init_online_profiling_cache_attack(params);
+    }
+    return init_cache_attack(params);
+}
+
+static int cache_run(primitive_ctx_t *ctx) {
+    __atomic_store_n(&cache_flag, 1, __ATOMIC_RELAXED);
+    if (ctx->params[NUM_PARAMS]) return online_profiling_cache_attack();
+    return cache_attack();
+}
+
+static void cache_request_stop(primitive_ctx_t *ctx) {
+    __atomic_store_n(&cache_flag, 0, __ATOMIC_RELAXED);
+    cache_attack_reset_if_necessary();
+}
+
+static int network_init(primitive_ctx_t *ctx, int *params) {
+    init_udp_attack(params);
+    return EXIT_SUCCESS;
+}
+
+static int network_run(primitive_ctx_t *ctx) {
+    __atomic_store_n(&udp_flag, 1, __ATOMIC_RELAXED);
+    if (ctx->params[NUM_PARAMS]) return online_profiling_stress_udp_flood();
+    return stress_udp_flood();
+}
+
+static int row_buffer_init(primitive_ctx_t *ctx, int *params) {
+    init_memory_row_buffer_attack(params);
+    return EXIT_SUCCESS;
+}
+
+static int row_buffer_run(primitive_ctx_t *ctx) {
+    __atomic_store_n(&row_buffer_flag, 1, __ATOMIC_RELAXED);
+    if (ctx->params[NUM_PARAMS])
+        return online_profiling_memory_row_buffer_attack();
+    return memory_row_buffer_attack();
+}
+
+static void row_buffer_request_stop(primitive_ctx_t *ctx) {
+    __atomic_store_n(&row_buffer_flag, 0, __ATOMIC_RELAXED);
+    row_buffer_attack_reset_if_necessary();
+}
+
+/*
+ *  Default parameter for different attack primitives
+ *  The parameters are overwritten by the command line (polyrhythm) or by
+ *  the parameter file passed with the -P command-line argument (rl).
+ */
+static const primitive_desc_t builtin_primitives[] = {
+    {CLASS_CACHE, "cache", {1, 6244, 1, 0, 0}, 0, cache_init, cache_run,
+     cache_request_stop},
+    {CLASS_TLB, "tlb", {500, 1, 1, 0, 0}, 1, .init_func = init_tlb_attack,
+     .attack_func = tlb_attack, .flag = &tlb_flag},
+    {CLASS_FILESYSTEM, "filesystem", {256, 16, 0, 0, 0},
+     .init_func = init_filesys_attack, .attack_func = filesys_attack,
+     .flag = &filesys_flag, .stats_func = filesys_attack_stats},
+    {CLASS_INTERRUPT, "interrupt", {0, 0, 64, 50, 0},
+     .init_func = init_interrupt_attack, .attack_func = interrupt_attack,
+     .flag = &interrupt_flag, .stats_func = interrupt_attack_stats},
+    {CLASS_DISK_IO, "disk_io", {50, 56223, 1, 0, 0},
+     .init_func = init_advise_disk_io_attack,
+     .attack_func = advise_disk_io_attack, .flag = &disk_flag,
+     .stats_func = advise_disk_io_attack_stats},
+    {CLASS_ROW_BUFFER, "row_buffer", {1, 10, 1, 0, 0}, 0, row_buffer_init,
+     row_buffer_run, row_buffer_request_stop},
+    {CLASS_NETWORK, "network", {65333, 2, 1, 0, 0}, 0, network_init,
+     network_run, .flag = &udp_flag},
+    {CLASS_MEMORY, "memory", {1, 1, 1, 0, 0},
+     .init_func = init_memory_contention_attack,
+     .attack_func = memory_contention_attack, .flag = &memory_ops_flag},
+    {CLASS_SCHEDULER, "scheduler", {100, 5, 0, 0, 0},
+     .init_func = init_context_switch_attack,
+     .attack_func = context_switch_attack, .flag = &context_switch_flag,
+     .stats_func = context_switch_attack_stats},
+    {CLASS_SPAWN, "spawn", {16, 0, 1000, 1, 0},
+     .init_func = init_spawn_attack, .attack_func = spawn_attack,
+     .flag = &spawn_flag, .stats_func = spawn_attack_stats},
+    {CLASS_PTR_CHASING, "ptr_chasing", {16384, 1, 0, 0, 0},
+     .init_func = init_pointer_chasing, .attack_func = pointer_chasing,
+     .flag = &ptr_chasing_flag, .stats_func = pointer_chasing_stats},
+    {CLASS_TCP, "tcp", {65536, 0, 0, 0, 0}, .init_func = init_tcp_attack,
+     .attack_func = tcp_attack, .flag = &tcp_flag,
+     .stats_func = tcp_attack_stats},
+    {CLASS_DISK_URING, "disk_uring", {25600, 4096, 32, 50, 0},
+     .init_func = init_uring_disk_io_attack,
+     .attack_func = uring_disk_io_attack, .flag = &uring_flag,
+     .stats_func = uring_disk_io_attack_stats},
+    {CLASS_DISK_READ, "disk_read", {25600, 65536, 1, 0, 0},
+     .init_func = init_disk_read_attack, .attack_func = disk_read_attack,
+     .flag = &disk_read_flag, .stats_func = disk_read_attack_stats},
+    {CLASS_FSNOTIFY, "fsnotify", {256, 4, 0, 0, 0},
+     .init_func = init_fsnotify_attack, .attack_func = fsnotify_attack,
+     .flag = &fsnotify_flag, .stats_func = fsnotify_attack_stats},
+    {CLASS_THREAD, "thread", {8, 0, 0, 0, 0},
+     .init_func = init_thread_churn_attack,
+     .attack_func = thread_churn_attack, .flag = &thread_churn_flag,
+     .stats_func = thread_churn_attack_stats},
+    {CLASS_PINGPONG, "pingpong", {-1, -1, 0, 0, 0},
+     .init_func = init_pingpong_attack, .attack_func = pingpong_attack,
+     .flag = &pingpong_flag, .stats_func = pingpong_attack_stats},
+    {CLASS_PIPE_IO, "pipe", {4096, 0, 0, 1, 0}, .init_func = init_pipe_attack,
+     .attack_func = pipe_attack, .flag = &pipe_flag,
+     .stats_func = pipe_attack_stats},
+    {CLASS_VM, "vm", {0, 64, 1, 0, 0}, .init_func = init_vm_attack,
+     .attack_func = vm_attack, .flag = &vm_flag, .stats_func = vm_attack_stats},
+    {CLASS_DEV, "dev", {0, 1048576, 0, 0, 0}, .init_func = init_dev_attack,
+     .attack_func = dev_attack, .flag = &dev_flag,
+     .stats_func = dev_attack_stats},
+};
+
+void register_builtin_primitives(void) {
+    unsigned int i;
+
+    for (i = 0; i < sizeof(builtin_primitives) / sizeof(builtin_primitives[0]);
+         i++) {
+        register_primitive(&builtin_primitives[i]);
+    }
+}
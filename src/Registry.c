@@ -0,0 +1,249 @@
+#include "Registry.h"
+
+#include <dlfcn.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Control.h"
+#include "Utils.h"
+
+/* Contexts, indexed by channel id */
+static primitive_ctx_t contexts[MAX_PRIMITIVES];
+
+/* Ids of the registered primitives, in registration order */
+static attack_channel_t order[MAX_PRIMITIVES];
+static int num_registered;
+
+/* Run time accounting of the contexts */
+static pthread_mutex_t accounting_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* Defaults of the vtable, for flag-driven primitives */
+
+static int flag_init(primitive_ctx_t *ctx, int *params) {
+    return ctx->desc.init_func(params);
+}
+
+static int flag_run(primitive_ctx_t *ctx) {
+    __atomic_store_n(ctx->desc.flag, 1, __ATOMIC_RELAXED);
+    return ctx->desc.attack_func();
+}
+
+static void flag_request_stop(primitive_ctx_t *ctx) {
+    __atomic_store_n(ctx->desc.flag, 0, __ATOMIC_RELAXED);
+}
+
+static void flag_stats(primitive_ctx_t *ctx) {
+    ctx->desc.stats_func(primitive_active_secs(ctx));
+}
+
+/**
+ * @brief Register one primitive
+ * @return EXIT_FAILURE on a duplicate or out-of-range id, or when a
+ * vtable entry has no flag-driven fallback
+ */
+int register_primitive(const primitive_desc_t *desc) {
+    primitive_ctx_t *ctx;
+
+    if (desc->id >= MAX_PRIMITIVES || desc->name == NULL) {
+        printf("Registry: invalid primitive id %u \n", desc->id);
+        return EXIT_FAILURE;
+    }
+    ctx = &contexts[desc->id];
+    if (ctx->desc.name != NULL || find_primitive(desc->name) != NULL) {
+        printf("Registry: primitive %s (id %u) is already registered \n",
+               desc->name, desc->id);
+        return EXIT_FAILURE;
+    }
+
+    memset(ctx, 0, sizeof(*ctx));
+    ctx->desc = *desc;
+    if (ctx->desc.init == NULL && ctx->desc.init_func != NULL)
+        ctx->desc.init = flag_init;
+    if (ctx->desc.run == NULL && ctx->desc.attack_func != NULL &&
+        ctx->desc.flag != NULL)
+        ctx->desc.run = flag_run;
+    if (ctx->desc.request_stop == NULL && ctx->desc.flag != NULL)
+        ctx->desc.request_stop = flag_request_stop;
+    if (ctx->desc.stats == NULL && ctx->desc.stats_func != NULL)
+        ctx->desc.stats = flag_stats;
+
+    if (ctx->desc.init == NULL || ctx->desc.run == NULL ||
+        ctx->desc.request_stop == NULL) {
+        printf("Registry: primitive %s misses init, run or request_stop \n",
+               desc->name);
+        memset(ctx, 0, sizeof(*ctx));
+        return EXIT_FAILURE;
+    }
+
+    memcpy(ctx->params, desc->default_params, sizeof(ctx->params));
+    order[num_registered++] = desc->id;
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Register the primitives of the plugins in POLYRHYTHM_PLUGINS
+ */
+int load_primitive_plugins(void) {
+    const primitive_desc_t *(*list)(int *count);
+    const primitive_desc_t *descs;
+    char *paths = getenv("POLYRHYTHM_PLUGINS"), *copy, *path, *save;
+    int ret = EXIT_SUCCESS, count, i;
+
+    if (paths == NULL || *paths == '\0') return EXIT_SUCCESS;
+
+    copy = strdup(paths);
+    for (path = strtok_r(copy, ":", &save); path != NULL;
+         path = strtok_r(NULL, ":", &save)) {
+        /* Never closed, the primitives run until the process exits */
+        void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+
+        if (handle == NULL) {
+            printf("Registry: cannot load plugin %s: %s \n", path, dlerror());
+            ret = EXIT_FAILURE;
+            continue;
+        }
+        *(void **)&list = dlsym(handle, "polyrhythm_primitives");
+        if (list == NULL) {
+            printf("Registry: %s does not export polyrhythm_primitives \n",
+                   path);
+            ret = EXIT_FAILURE;
+            continue;
+        }
+
+        descs = list(&count);
+        for (i = 0; i < count; i++) {
+            if (register_primitive(&descs[i]) != EXIT_SUCCESS)
+                ret = EXIT_FAILURE;
+        }
+    }
+
+    free(copy);
+    return ret;
+}
+
+primitive_ctx_t *get_primitive(attack_channel_t id) {
+    if (id >= MAX_PRIMITIVES || contexts[id].desc.name == NULL) return NULL;
+    return &contexts[id];
+}
+
+primitive_ctx_t *find_primitive(const char *name) {
+    int i;
+
+    for (i = 0; i < num_registered; i++) {
+        if (strcmp(contexts[order[i]].desc.name, name) == 0)
+            return &contexts[order[i]];
+    }
+    return NULL;
+}
+
+int num_primitives(void) { return num_registered; }
+
+primitive_ctx_t *primitive_at(int index) {
+    if (index < 0 || index >= num_registered) return NULL;
+    return &contexts[order[index]];
+}
+
+/**
+ * @brief Call init with the context's parameters, and arm its threads
+ */
+int init_primitive(primitive_ctx_t *ctx) {
+    if (ctx->desc.max_threads && ctx->num_threads > ctx->desc.max_threads) {
+        printf("Primitive %s supports %d attack thread(s) per instance.\n",
+               ctx->desc.name, ctx->desc.max_threads);
+        ctx->num_threads = ctx->desc.max_threads;
+    }
+    if (ctx->desc.init(ctx, ctx->params) != EXIT_SUCCESS) return EXIT_FAILURE;
+
+    __atomic_store_n(&ctx->pending, ctx->num_threads, __ATOMIC_RELEASE);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Run the primitive in the caller, under the caller's control block
+ */
+int run_primitive(primitive_ctx_t *ctx) {
+    int ret;
+
+    pthread_mutex_lock(&accounting_lock);
+    if (ctx->active++ == 0) ctx->active_since = get_current_time_ns();
+    ctx->runs++;
+    pthread_mutex_unlock(&accounting_lock);
+
+    ctl_enter(ctx->desc.id);
+    ret = ctx->desc.run(ctx);
+    ctl_leave();
+
+    pthread_mutex_lock(&accounting_lock);
+    if (--ctx->active == 0)
+        ctx->active_ns += get_current_time_ns() - ctx->active_since;
+    pthread_mutex_unlock(&accounting_lock);
+    return ret;
+}
+
+/**
+ * @brief Claim one pending thread and run the primitive in the caller
+ */
+int run_next_primitive(void) {
+    int i, pending;
+
+    if (ctl_stopping()) return EXIT_FAILURE;
+
+    for (i = 0; i < num_registered; i++) {
+        primitive_ctx_t *ctx = &contexts[order[i]];
+
+        pending = __atomic_load_n(&ctx->pending, __ATOMIC_ACQUIRE);
+        while (pending > 0) {
+            if (__atomic_compare_exchange_n(&ctx->pending, &pending,
+                                            pending - 1, 0,
+                                            __ATOMIC_ACQ_REL,
+                                            __ATOMIC_ACQUIRE)) {
+                run_primitive(ctx);
+                return EXIT_SUCCESS;
+            }
+        }
+    }
+    return EXIT_FAILURE;
+}
+
+/**
+ * @brief Stop the attack threads through their control blocks, and clear
+ * the loop flags for the helper threads of the primitives
+ */
+void stop_all_primitives(void) {
+    int i;
+
+    ctl_stop_all();
+    for (i = 0; i < num_registered; i++) {
+        primitive_ctx_t *ctx = &contexts[order[i]];
+
+        ctx->desc.request_stop(ctx);
+    }
+}
+
+/**
+ * @brief Active time of a primitive, including the current period
+ */
+double primitive_active_secs(primitive_ctx_t *ctx) {
+    uint64_t ns;
+
+    pthread_mutex_lock(&accounting_lock);
+    ns = ctx->active_ns;
+    if (ctx->active) ns += get_current_time_ns() - ctx->active_since;
+    pthread_mutex_unlock(&accounting_lock);
+    return (double)ns / NANOSEC;
+}
+
+/**
+ * @brief Print the totals of the primitives that ran, once they stopped
+ */
+void print_primitive_stats(void) {
+    int i;
+
+    for (i = 0; i < num_registered; i++) {
+        primitive_ctx_t *ctx = &contexts[order[i]];
+
+        if (ctx->runs && ctx->desc.stats != NULL) ctx->desc.stats(ctx);
+    }
+}
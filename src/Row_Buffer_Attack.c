@@ -4,6 +4,7 @@
 #include <time.h>
 
 #include "Attacks.h"
+#include "Control.h"
 #include "PolyRhythm.h"
 #include "Utils.h"
 
@@ -16,7 +17,6 @@
  * To stop attack primitives
  */
 extern int row_buffer_flag;
-extern struct action *shared_memory_action;
 
 /* feedbacks for RL, defined in PolyRhythm_RL.c */
 extern unsigned long int row_buffer_contention_count;
@@ -36,6 +36,9 @@ static long int last_timing;
 // If we do not use while loop
 #define ROW_ITERATIONS 3
 
+// Random accesses between two checks for a stop or switch
+#define ROW_QUANTUM 1024
+
 static int *row_buffer_attack_array_a[DESIRED_NUM_THREAD];
 static int *row_buffer_attack_array_b[DESIRED_NUM_THREAD];
 static int *row_buffer_attack_array_index[DESIRED_NUM_THREAD];
@@ -134,6 +137,7 @@ int init_memory_row_buffer_attack(void *arguments) {
  */
 int memory_row_buffer_attack() {
     int i, j;
+    unsigned int work = 0;
 
     double scalar = 1.7;  // this is a magic number
 
@@ -162,14 +166,14 @@ int memory_row_buffer_attack() {
 #ifdef RL_ONLINE
 
 #ifdef TIMER
-    while (shared_memory_action->row_buffer) {
+    while (attack_continue(&row_buffer_flag)) {
 #else
     for (int it = 0; it < ROW_ITERATIONS; it++) {
 #endif
 
 #else
     /* For normal mode of PolyRhythm */
-    while (row_buffer_flag) {
+    while (attack_continue(&row_buffer_flag)) {
 #endif
 
         int offset = 80;
@@ -180,12 +184,16 @@ int memory_row_buffer_attack() {
              i += jump)  // accelerate the loop
         {
             a_array[index_array[i]] = b_array[index_array[i]];
+            if (!attack_continue_every(&work, ROW_QUANTUM, &row_buffer_flag))
+                break;
 
             // b_array[index_array[i]] = a_array[index_array[i]];
         }
 
         for (j = 0; j < ram_mem_size / sizeof(int); j++) {
             b_array[index_array[j]] = a_array[index_array[j]];
+            if (!attack_continue_every(&work, ROW_QUANTUM, &row_buffer_flag))
+                break;
             // b_array[index_array[j]] = 0xff; // Different access pattern
         }
 
@@ -266,6 +274,7 @@ int online_profiling_row_buffer_memory_switch_back() {
  */
 int online_profiling_memory_row_buffer_attack() {
     int i, j;
+    unsigned int work = 0;
 
     double scalar = 1.7;  // this is a magic number
 
@@ -284,7 +293,7 @@ int online_profiling_memory_row_buffer_attack() {
     // We calculate the least contended region after a fix number of loops
     int tmp_count = 0;
     long int timing = 0;
-    while (row_buffer_flag) {
+    while (attack_continue(&row_buffer_flag)) {
         long start = get_current_time_us();
 
         int offset = 80;
@@ -295,10 +304,14 @@ int online_profiling_memory_row_buffer_attack() {
              i += jump)  // accelerate the loop
         {
             a_array[index_array[i]] = b_array[index_array[i]];
+            if (!attack_continue_every(&work, ROW_QUANTUM, &row_buffer_flag))
+                break;
         }
 
         for (j = 0; j < ram_mem_size / sizeof(int); j++) {
             b_array[index_array[j]] = a_array[index_array[j]];
+            if (!attack_continue_every(&work, ROW_QUANTUM, &row_buffer_flag))
+                break;
         }
 
         long end = get_current_time_us();
@@ -349,7 +362,7 @@ no_profiling:
     printf("Entering the attack loop \n");
     /* Attack loop */
     /* With less if else predicate, this attack loop is more effective */
-    while (row_buffer_flag) {
+    while (attack_continue(&row_buffer_flag)) {
         int offset = 80;
         int jump =
             rand() % offset + offset;  // Generate random number from 80 to 160
@@ -358,10 +371,14 @@ no_profiling:
              i += jump)  // accelerate the loop
         {
             a_array[index_array[i]] = b_array[index_array[i]];
+            if (!attack_continue_every(&work, ROW_QUANTUM, &row_buffer_flag))
+                break;
         }
 
         for (j = 0; j < ram_mem_size / sizeof(int); j++) {
             b_array[index_array[j]] = a_array[index_array[j]];
+            if (!attack_continue_every(&work, ROW_QUANTUM, &row_buffer_flag))
+                break;
         }
 
         /* Count the cache loop, less count means more cache contention */
@@ -0,0 +1,548 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/eventfd.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Attacks.h"
+#include "Control.h"
+#include "Histogram.h"
+#include "PolyRhythm.h"
+#include "Utils.h"
+
+/* Extern trigger flags
+ * To stop attack primitives
+ */
+extern int context_switch_flag;
+extern int pingpong_flag;
+
+/********************************************
+ * Parameters for context switch attack *****
+ *
+ * Implements a context switching attack
+ * If run by a high-priority attacker with utilization constrained
+ * (e.g. SCHED_FIFO or SCHED_DEADLINE from the launcher),
+ * it should induce a large number of context switches in the victim
+ *
+ * Every attack thread wakes up on absolute deadlines at a fixed period,
+ * does a short burst of work, and sleeps again. This preempts the victim
+ * at a precise rate without using much of the attacker's given
+ * bandwidth/utilization
+ *
+ * The deadlines of all threads lie on one grid, anchored at the period
+ * boundary after the first thread starts. A thread joins the grid at the
+ * next deadline when it enters the primitive and after every burst mode
+ * park, so the time spent outside it is not counted as missed deadlines.
+ *
+ * ******************************************
+ */
+
+#define SCHED_MIN_PERIOD_US 10
+#define SCHED_REPORT_INTERVAL_US 1000000  // Print rates once per second
+
+enum sched_timer { timer_nanosleep = 0, timer_timerfd };
+
+/* Global variables */
+static uint64_t period_ns;
+static uint64_t work_ns;
+static uint64_t phase_ns;
+static int timer_mode;
+static uint64_t epoch_ns;  // Grid origin, shared so the threads align; 0:
+                           // no thread started yet
+
+static int next_thread_index;
+
+/* Statistics of all threads, merged once per second */
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static latency_hist_t wakeup_hist;
+static unsigned long missed_deadlines;
+
+/* Since the start, for stats */
+static latency_hist_t run_wakeup_hist;
+static unsigned long run_missed;
+
+/**
+ * @brief Initialize context switch attack channels
+ * @param:
+ * 0: wakeup period, in us (at least 10)
+ * 1: work done after each wakeup, in us
+ * 2: timer, 0: clock_nanosleep(TIMER_ABSTIME), 1: periodic timerfd
+ * 3: phase offset between consecutive attack threads, in us
+ *    (0: all threads wake up together)
+ */
+int init_context_switch_attack(void *arguments) {
+    int *args = (int *)arguments;
+
+    period_ns = (uint64_t)args[0] * 1000;
+    work_ns = (uint64_t)args[1] * 1000;
+    timer_mode = args[2];
+    phase_ns = (uint64_t)args[3] * 1000;
+
+    if (args[0] < SCHED_MIN_PERIOD_US || args[1] < 0 || args[3] < 0 ||
+        work_ns >= period_ns) {
+        printf("Scheduler Attack: need period >= %d us and work < period \n",
+               SCHED_MIN_PERIOD_US);
+        return EXIT_FAILURE;
+    }
+
+    if (timer_mode != timer_nanosleep && timer_mode != timer_timerfd) {
+        printf("Scheduler Attack: unknown timer %d \n", timer_mode);
+        return EXIT_FAILURE;
+    }
+
+    epoch_ns = 0;
+    hist_reset(&wakeup_hist);
+    hist_reset(&run_wakeup_hist);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Burn the CPU until the given time
+ */
+static void spin_until(uint64_t until_ns) {
+    while (get_current_time_ns() < until_ns) {
+    }
+}
+
+/**
+ * @brief Next deadline of a thread on the shared grid, after now
+ */
+static uint64_t next_deadline(int index) {
+    uint64_t now = get_current_time_ns();
+    uint64_t epoch = __atomic_load_n(&epoch_ns, __ATOMIC_ACQUIRE);
+    uint64_t first = (now / period_ns + 1) * period_ns;
+
+    /* The first thread to start anchors the grid for all of them; if
+     * another one wins the race, epoch is set to its value */
+    if (epoch == 0 &&
+        __atomic_compare_exchange_n(&epoch_ns, &epoch, first, 0,
+                                    __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+        epoch = first;
+
+    epoch += index * phase_ns;
+    if (epoch > now) return epoch;
+    return epoch + ((now - epoch) / period_ns + 1) * period_ns;
+}
+
+/**
+ * @brief Arm the timerfd on deadline, dropping pending expirations
+ */
+static int arm_timer(int tfd, uint64_t deadline) {
+    struct itimerspec its = {0};
+
+    its.it_value.tv_sec = deadline / NANOSEC;
+    its.it_value.tv_nsec = deadline % NANOSEC;
+    its.it_interval.tv_sec = period_ns / NANOSEC;
+    its.it_interval.tv_nsec = period_ns % NANOSEC;
+    return timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+/**
+ * @brief Main context switch attack loop.
+ */
+int context_switch_attack() {
+    static __thread int index = -1;  // Kept when the thread re-enters
+    struct timespec ts;
+    uint64_t deadline, expirations, released = 0;
+    int tfd = -1;
+
+    unsigned long wakeups = 0, missed = 0;
+    long last_report = get_current_time_us();
+    latency_hist_t hist;
+
+    if (index < 0)
+        index = __atomic_fetch_add(&next_thread_index, 1, __ATOMIC_RELAXED);
+    deadline = next_deadline(index);
+
+    /* The default timer slack (50us) would swamp short periods */
+    (void)prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+
+    if (timer_mode == timer_timerfd) {
+        tfd = timerfd_create(CLOCK_MONOTONIC, 0);
+        if (tfd < 0 || arm_timer(tfd, deadline) < 0) {
+            printf("Scheduler Attack: timerfd failed, errno=%d (%s)\n", errno,
+                   strerror(errno));
+            if (tfd >= 0) close(tfd);
+            return EXIT_FAILURE;
+        }
+    }
+
+    hist_reset(&hist);
+
+    while (attack_continue(&context_switch_flag)) {
+        uint64_t now;
+
+        /* Released after a burst mode park: rejoin the grid */
+        if (attack_self != NULL && attack_self->burst_release_ns != released) {
+            released = attack_self->burst_release_ns;
+            deadline = next_deadline(index);
+            if (tfd >= 0) arm_timer(tfd, deadline);
+        }
+
+        if (timer_mode == timer_timerfd) {
+            if (read(tfd, &expirations, sizeof(expirations)) !=
+                sizeof(expirations))
+                continue;
+            /* Every expiration past the first is a missed deadline */
+            missed += expirations - 1;
+            deadline += (expirations - 1) * period_ns;
+        } else {
+            ts.tv_sec = deadline / NANOSEC;
+            ts.tv_nsec = deadline % NANOSEC;
+            if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL))
+                continue;
+        }
+
+        now = get_current_time_ns();
+        hist_record(&hist, now - deadline);
+        wakeups++;
+
+        spin_until(now + work_ns);
+
+        deadline += period_ns;
+        if (timer_mode == timer_nanosleep) {
+            /* Skip the deadlines we are already late for */
+            now = get_current_time_ns();
+            while (deadline < now) {
+                deadline += period_ns;
+                missed++;
+            }
+        }
+
+        long now_us = get_current_time_us();
+        if (now_us - last_report >= SCHED_REPORT_INTERVAL_US) {
+            pthread_mutex_lock(&stats_lock);
+            hist_merge(&wakeup_hist, &hist);
+            hist_merge(&run_wakeup_hist, &hist);
+            missed_deadlines += missed;
+            run_missed += missed;
+
+            /* The first attack thread reports for all of them */
+            if (index == 0) {
+                printf("[Scheduler] %.0f wakeups/s per thread (target %.0f), "
+                       "%lu missed deadlines over %d threads\n",
+                       (double)wakeups / (now_us - last_report) * MICROSEC,
+                       (double)NANOSEC / period_ns, missed_deadlines,
+                       __atomic_load_n(&next_thread_index, __ATOMIC_RELAXED));
+                hist_print(&wakeup_hist, "Wakeup latency");
+                hist_reset(&wakeup_hist);
+                missed_deadlines = 0;
+            }
+            pthread_mutex_unlock(&stats_lock);
+
+            hist_reset(&hist);
+            wakeups = missed = 0;
+            last_report = now_us;
+        }
+    }
+
+    pthread_mutex_lock(&stats_lock);
+    hist_merge(&run_wakeup_hist, &hist);
+    run_missed += missed;
+    pthread_mutex_unlock(&stats_lock);
+
+    if (tfd >= 0) close(tfd);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Print the wakeups and missed deadlines of all threads since the
+ * start
+ */
+void context_switch_attack_stats(double secs) {
+    pthread_mutex_lock(&stats_lock);
+    printf("[Scheduler] total over %.1f s: %lu wakeups (%.0f/s over %d "
+           "threads, target %.0f per thread), %lu missed deadlines\n",
+           secs, run_wakeup_hist.count,
+           secs > 0 ? run_wakeup_hist.count / secs : 0,
+           __atomic_load_n(&next_thread_index, __ATOMIC_RELAXED),
+           (double)NANOSEC / period_ns, run_missed);
+    hist_print(&run_wakeup_hist, "Wakeup latency, total");
+    pthread_mutex_unlock(&stats_lock);
+}
+
+/********************************************
+ * Parameters for ping-pong attack **********
+ *
+ * Pairs of threads, pinned on chosen cores, bounce a token between them.
+ * Every hop wakes up the other thread, which costs a rescheduling IPI and
+ * a context switch on its core when it sits on the victim's core (or a
+ * neighbour). The round-trip latency shows how the wakeups degrade.
+ *
+ * ******************************************
+ */
+
+enum pingpong_method {
+    pingpong_futex = 0,
+    pingpong_eventfd,
+    pingpong_pipe,
+    pingpong_num_methods
+};
+
+static const char *pingpong_method_names[pingpong_num_methods] = {
+    "futex", "eventfd", "pipe"};
+
+/* One pinger (the attack thread) and its ponger */
+struct pingpong_pair {
+    int token;    // futex word, 1 while the ponger holds the token
+    int stop;     // Set by the pinger before its last hop
+    int fds[2];   // eventfds, to the ponger and to the pinger
+    int pipes[2][2];  // Likewise
+    int cpu;      // Core of the ponger, -1 if not pinned
+};
+
+/* Global variables */
+static int pinger_cpu;
+static int ponger_cpu;
+static int pingpong_method;
+static uint64_t hop_interval_ns;  // Per round trip, 0: unthrottled
+
+static int next_pair_index;
+
+static pthread_mutex_t pingpong_lock = PTHREAD_MUTEX_INITIALIZER;
+static latency_hist_t rtt_hist;
+static latency_hist_t run_rtt_hist;  // Since the start, for stats
+
+/**
+ * @brief Initialize ping-pong attack channels
+ * @param:
+ * 0: core of the first pinger, the next attack threads use the next cores
+ *    (-1: not pinned)
+ * 1: core of the first ponger, likewise (-1: not pinned)
+ * 2: method, 0: futex, 1: eventfd, 2: pipe
+ * 3: round trips per second per pair (0: as fast as possible)
+ */
+int init_pingpong_attack(void *arguments) {
+    int *args = (int *)arguments;
+
+    pinger_cpu = args[0];
+    ponger_cpu = args[1];
+    pingpong_method = args[2];
+
+    if (pingpong_method < 0 || pingpong_method >= pingpong_num_methods ||
+        args[3] < 0) {
+        printf("Pingpong Attack: unknown method %d \n", pingpong_method);
+        return EXIT_FAILURE;
+    }
+    hop_interval_ns = args[3] ? NANOSEC / args[3] : 0;
+    hist_reset(&rtt_hist);
+    hist_reset(&run_rtt_hist);
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Pin the calling thread, -1 leaves it free
+ */
+static void pin_to_cpu(int cpu) {
+    cpu_set_t set;
+
+    if (cpu < 0) return;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % sysconf(_SC_NPROCESSORS_ONLN), &set);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set)) {
+        printf("Pingpong Attack: cannot pin to core %d \n", cpu);
+    }
+}
+
+static long futex(int *uaddr, int op, int val) {
+    return syscall(SYS_futex, uaddr, op | FUTEX_PRIVATE_FLAG, val, NULL, NULL,
+                   0);
+}
+
+/**
+ * @brief Hand the token to the other side and wait for it to come back
+ * @to_ponger: direction of the hop, for the futex word
+ */
+static void pass_token(struct pingpong_pair *pair, int to_ponger) {
+    uint64_t value = 1;
+    char byte = 0;
+
+    switch (pingpong_method) {
+        case pingpong_futex:
+            __atomic_store_n(&pair->token, to_ponger, __ATOMIC_RELEASE);
+            futex(&pair->token, FUTEX_WAKE, 1);
+            while (__atomic_load_n(&pair->token, __ATOMIC_ACQUIRE) ==
+                   to_ponger) {
+                futex(&pair->token, FUTEX_WAIT, to_ponger);
+            }
+            break;
+        case pingpong_eventfd:
+            (void)write(pair->fds[to_ponger ? 0 : 1], &value, sizeof(value));
+            (void)read(pair->fds[to_ponger ? 1 : 0], &value, sizeof(value));
+            break;
+        case pingpong_pipe:
+            (void)write(pair->pipes[to_ponger ? 0 : 1][1], &byte, 1);
+            (void)read(pair->pipes[to_ponger ? 1 : 0][0], &byte, 1);
+            break;
+    }
+}
+
+/**
+ * @brief Wait for the first token, on the ponger side
+ */
+static void wait_token(struct pingpong_pair *pair) {
+    uint64_t value;
+    char byte;
+
+    switch (pingpong_method) {
+        case pingpong_futex:
+            while (__atomic_load_n(&pair->token, __ATOMIC_ACQUIRE) == 0) {
+                futex(&pair->token, FUTEX_WAIT, 0);
+            }
+            break;
+        case pingpong_eventfd:
+            (void)read(pair->fds[0], &value, sizeof(value));
+            break;
+        case pingpong_pipe:
+            (void)read(pair->pipes[0][0], &byte, 1);
+            break;
+    }
+}
+
+/**
+ * @brief Ponger thread: returns every token until told to stop
+ */
+static void *ponger(void *arg) {
+    struct pingpong_pair *pair = (struct pingpong_pair *)arg;
+
+    pin_to_cpu(pair->cpu);
+    wait_token(pair);
+    while (!__atomic_load_n(&pair->stop, __ATOMIC_ACQUIRE)) {
+        pass_token(pair, 0);
+    }
+
+    /* Hand the last token back so the pinger is not left waiting */
+    if (pingpong_method == pingpong_futex) {
+        __atomic_store_n(&pair->token, 0, __ATOMIC_RELEASE);
+        futex(&pair->token, FUTEX_WAKE, 1);
+    } else if (pingpong_method == pingpong_eventfd) {
+        uint64_t value = 1;
+        (void)write(pair->fds[1], &value, sizeof(value));
+    } else {
+        char byte = 0;
+        (void)write(pair->pipes[1][1], &byte, 1);
+    }
+    return NULL;
+}
+
+/**
+ * @brief Main ping-pong attack loop, on the pinger side.
+ */
+int pingpong_attack() {
+    struct pingpong_pair pair;
+    struct timespec ts;
+    pthread_t thread;
+    uint64_t deadline = get_current_time_ns();
+    int index;
+
+    unsigned long round_trips = 0;
+    long last_report = get_current_time_us();
+    latency_hist_t hist;
+
+    memset(&pair, 0, sizeof(pair));
+    index = __atomic_fetch_add(&next_pair_index, 1, __ATOMIC_RELAXED);
+    pair.cpu = ponger_cpu < 0 ? -1 : ponger_cpu + index;
+    pin_to_cpu(pinger_cpu < 0 ? -1 : pinger_cpu + index);
+
+    if (pingpong_method == pingpong_eventfd) {
+        pair.fds[0] = eventfd(0, 0);
+        pair.fds[1] = eventfd(0, 0);
+        if (pair.fds[0] < 0 || pair.fds[1] < 0) return EXIT_FAILURE;
+    } else if (pingpong_method == pingpong_pipe) {
+        if (pipe(pair.pipes[0]) < 0 || pipe(pair.pipes[1]) < 0)
+            return EXIT_FAILURE;
+    }
+
+    if (pthread_create(&thread, NULL, ponger, &pair) != 0) {
+        printf("Pingpong Attack: cannot create ponger thread \n");
+        return EXIT_FAILURE;
+    }
+    hist_reset(&hist);
+
+    while (attack_continue(&pingpong_flag)) {
+        uint64_t start = get_current_time_ns();
+
+        pass_token(&pair, 1);
+        hist_record(&hist, get_current_time_ns() - start);
+        round_trips++;
+
+        if (hop_interval_ns) {
+            deadline += hop_interval_ns;
+            if (deadline > start) {
+                ts.tv_sec = deadline / NANOSEC;
+                ts.tv_nsec = deadline % NANOSEC;
+                clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+            } else if (start - deadline > NANOSEC) {
+                deadline = start;
+            }
+        }
+
+        long now = get_current_time_us();
+        if (now - last_report >= SCHED_REPORT_INTERVAL_US) {
+            pthread_mutex_lock(&pingpong_lock);
+            hist_merge(&rtt_hist, &hist);
+            hist_merge(&run_rtt_hist, &hist);
+
+            /* The first attack thread reports for all of them */
+            if (index == 0) {
+                printf("[Pingpong] %.0f round trips/s per pair with %s over "
+                       "%d pairs\n",
+                       (double)round_trips / (now - last_report) * MICROSEC,
+                       pingpong_method_names[pingpong_method],
+                       __atomic_load_n(&next_pair_index, __ATOMIC_RELAXED));
+                hist_print(&rtt_hist, "Round-trip latency");
+                hist_reset(&rtt_hist);
+            }
+            pthread_mutex_unlock(&pingpong_lock);
+
+            hist_reset(&hist);
+            round_trips = 0;
+            last_report = now;
+        }
+    }
+
+    pthread_mutex_lock(&pingpong_lock);
+    hist_merge(&run_rtt_hist, &hist);
+    pthread_mutex_unlock(&pingpong_lock);
+
+    __atomic_store_n(&pair.stop, 1, __ATOMIC_RELEASE);
+    pass_token(&pair, 1);
+    pthread_join(thread, NULL);
+
+    if (pingpong_method == pingpong_eventfd) {
+        close(pair.fds[0]);
+        close(pair.fds[1]);
+    } else if (pingpong_method == pingpong_pipe) {
+        close(pair.pipes[0][0]);
+        close(pair.pipes[0][1]);
+        close(pair.pipes[1][0]);
+        close(pair.pipes[1][1]);
+    }
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Print the round trips of all pairs since the start
+ */
+void pingpong_attack_stats(double secs) {
+    pthread_mutex_lock(&pingpong_lock);
+    printf("[Pingpong] total over %.1f s: %lu round trips (%.0f/s) with %s "
+           "over %d pairs\n",
+           secs, run_rtt_hist.count, secs > 0 ? run_rtt_hist.count / secs : 0,
+           pingpong_method_names[pingpong_method],
+           __atomic_load_n(&next_pair_index, __ATOMIC_RELAXED));
+    hist_print(&run_rtt_hist, "Round-trip latency, total");
+    pthread_mutex_unlock(&pingpong_lock);
+}
@@ -0,0 +1,100 @@
+#include "Shm.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static char instance_name[SHM_INSTANCE_MAX + 1];
+
+/**
+ * @brief Whether an instance name is usable in a shared memory name
+ */
+static int valid_instance(const char *instance) {
+    size_t len = strlen(instance);
+
+    if (len == 0 || len > SHM_INSTANCE_MAX) return 0;
+    return strspn(instance, "abcdefghijklmnopqrstuvwxyz"
+                            "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                            "0123456789_-.") == len;
+}
+
+int shm_set_instance(const char *instance) {
+    if (!valid_instance(instance)) {
+        printf("Shm: invalid instance name %s, use up to %d letters, "
+               "digits, '_', '-' or '.' \n",
+               instance, SHM_INSTANCE_MAX);
+        return EXIT_FAILURE;
+    }
+    snprintf(instance_name, sizeof(instance_name), "%s", instance);
+    return EXIT_SUCCESS;
+}
+
+const char *shm_instance(void) {
+    const char *env;
+
+    if (instance_name[0] == '\0') {
+        env = getenv(SHM_INSTANCE_ENV);
+        if (env == NULL || shm_set_instance(env) != EXIT_SUCCESS)
+            snprintf(instance_name, sizeof(instance_name), "%s",
+                     SHM_INSTANCE_DEFAULT);
+    }
+    return instance_name;
+}
+
+int shm_name(char *buf, size_t len, const char *instance,
+             const char *segment) {
+    if (!valid_instance(instance) ||
+        (size_t)snprintf(buf, len, "/polyrhythm.%s.%s", instance, segment) >=
+            len) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
+
+void *shm_map(const char *instance, const char *segment, size_t size,
+              int create) {
+    char name[SHM_INSTANCE_MAX + 32];
+    struct stat st;
+    void *addr;
+    int fd, err;
+
+    if (shm_name(name, sizeof(name), instance, segment) < 0) return NULL;
+
+    /* Created here: not restricted by the umask, like the SysV segments
+     * used before */
+    fd = create ? shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0666) : -1;
+    if (fd >= 0) {
+        (void)fchmod(fd, 0666);
+    } else if (!create || errno == EEXIST) {
+        fd = shm_open(name, O_RDWR, 0);
+    }
+    if (fd < 0) return NULL;
+
+    /* A segment of an older, smaller layout is grown; version fields
+     * tell the rest */
+    if (fstat(fd, &st) < 0) goto fail;
+    if ((size_t)st.st_size < size) {
+        if (!create) {
+            errno = EINVAL;
+            goto fail;
+        }
+        if (ftruncate(fd, size) < 0) goto fail;
+    }
+
+    addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED) goto fail;
+    close(fd);
+    return addr;
+
+fail:
+    err = errno;
+    close(fd);
+    errno = err;
+    return NULL;
+}
@@ -0,0 +1,519 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <libgen.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Attacks.h"
+#include "Control.h"
+#include "Histogram.h"
+#include "PolyRhythm.h"
+#include "Utils.h"
+
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+/* Extern trigger flags
+ * To stop attack primitives
+ */
+extern int spawn_flag;
+extern int thread_churn_flag;
+
+extern char **environ;
+
+/*************************************
+ * Process churn attack
+ * Keeps a bounded pool of short-lived children per attack thread, and
+ * replaces every child that exits. This puts sustained pressure on the
+ * scheduler, the mm (address space copies and teardown) and the PID
+ * allocator, at a controllable level instead of an unbounded fork bomb.
+ * ***********************************
+ */
+
+#define SPAWN_MAX_CHILDREN 1024
+#define SPAWN_STACK_SIZE (64 * KB)  // Stack of clone(CLONE_VM) children
+#define SPAWN_HELPER "spawn_helper"
+#define SPAWN_REPORT_INTERVAL_US 1000000  // Print rates once per second
+
+enum spawn_method {
+    spawn_fork = 0,
+    spawn_vfork,
+    spawn_clone_vm,
+    spawn_posix_spawn,
+    spawn_num_methods
+};
+
+static const char *spawn_method_names[spawn_num_methods] = {
+    "fork", "vfork", "clone(CLONE_VM)", "posix_spawn"};
+
+/* How exited children are reaped */
+enum reap_method { reap_waitid = 0, reap_pidfd };
+
+/* A live child */
+struct child {
+    pid_t pid;
+    int pidfd;
+    char *stack;  // Owned by the slot, travels with the child when swapped
+};
+
+/* Global variables */
+static int max_children;
+static int method;
+static int reap_mode;
+static int child_lifetime_us;
+static char helper_path[PATH_MAX];
+static char lifetime_arg[16];
+
+/* Spawn latencies of all threads since the start, for stats */
+static pthread_mutex_t run_lock = PTHREAD_MUTEX_INITIALIZER;
+static latency_hist_t run_spawn_hist;
+static latency_hist_t run_thread_hist;
+
+/**
+ * @brief Add the latencies of a thread to the totals
+ */
+static void add_run_hist(latency_hist_t *run, const latency_hist_t *hist) {
+    pthread_mutex_lock(&run_lock);
+    hist_merge(run, hist);
+    pthread_mutex_unlock(&run_lock);
+}
+
+/**
+ * @brief Body of the children: live for the configured time, then exit
+ * Only uses the raw syscall, so that it is safe after fork() in a
+ * multi-threaded process and in a child sharing our memory.
+ */
+static int child_main(void *arg) {
+    struct timespec ts = {.tv_sec = child_lifetime_us / MICROSEC,
+                          .tv_nsec = (child_lifetime_us % MICROSEC) * 1000L};
+
+    (void)arg;
+    if (child_lifetime_us > 0) syscall(SYS_nanosleep, &ts, NULL);
+    return 0;
+}
+
+/**
+ * @brief Initialize spawn attack channels
+ * @param:
+ * 0: maximum number of live children per attack thread
+ * 1: method, 0: fork, 1: vfork, 2: clone(CLONE_VM), 3: posix_spawn of
+ *    the spawn_helper binary next to ours
+ * 2: lifetime of each child, in us (vfork children exit at once)
+ * 3: reaping, 0: waitid on the oldest child, 1: poll pidfds, reap any
+ */
+int init_spawn_attack(void *arguments) {
+    int *args = (int *)arguments;
+    char exe[PATH_MAX];
+    ssize_t len;
+
+    max_children = args[0];
+    method = args[1];
+    child_lifetime_us = args[2];
+    reap_mode = args[3];
+
+    if (max_children <= 0 || max_children > SPAWN_MAX_CHILDREN) {
+        printf("Spawn Attack: live children must be within [1, %d] \n",
+               SPAWN_MAX_CHILDREN);
+        return EXIT_FAILURE;
+    }
+
+    if (method < 0 || method >= spawn_num_methods || child_lifetime_us < 0) {
+        printf("Spawn Attack: unknown method %d \n", method);
+        return EXIT_FAILURE;
+    }
+
+    if (method == spawn_posix_spawn) {
+        /* The helper is built next to the polyrhythm binaries */
+        len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+        if (len < 0) {
+            printf("Spawn Attack: cannot read /proc/self/exe \n");
+            return EXIT_FAILURE;
+        }
+        exe[len] = '\0';
+        snprintf(helper_path, sizeof(helper_path), "%s/%s", dirname(exe),
+                 SPAWN_HELPER);
+        if (access(helper_path, X_OK) < 0) {
+            printf("Spawn Attack: cannot execute %s: errno=%d (%s)\n",
+                   helper_path, errno, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        snprintf(lifetime_arg, sizeof(lifetime_arg), "%d", child_lifetime_us);
+    }
+
+#ifdef SYS_pidfd_open
+    if (reap_mode == reap_pidfd) {
+        int fd = syscall(SYS_pidfd_open, getpid(), 0);
+
+        if (fd < 0) {
+            printf("Spawn Attack: pidfd unavailable (%s), using waitid \n",
+                   strerror(errno));
+            reap_mode = reap_waitid;
+        } else {
+            close(fd);
+        }
+    }
+#else
+    reap_mode = reap_waitid;
+#endif
+
+    hist_reset(&run_spawn_hist);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Start one child
+ * @return: its pid, or -1 with errno set
+ */
+static pid_t spawn_child(struct child *c) {
+    char *helper_argv[] = {SPAWN_HELPER, lifetime_arg, NULL};
+    pid_t pid;
+    int ret;
+
+    switch (method) {
+        case spawn_fork:
+            pid = fork();
+            if (pid == 0) _exit(child_main(NULL));
+            return pid;
+        case spawn_vfork:
+            /* The parent is suspended until the child exits */
+            pid = vfork();
+            if (pid == 0) _exit(0);
+            return pid;
+        case spawn_clone_vm:
+            return clone(child_main, c->stack + SPAWN_STACK_SIZE,
+                         CLONE_VM | SIGCHLD, NULL);
+        case spawn_posix_spawn:
+            ret = posix_spawn(&pid, helper_path, NULL, NULL, helper_argv,
+                              environ);
+            if (ret != 0) {
+                errno = ret;
+                return -1;
+            }
+            return pid;
+        default:
+            errno = EINVAL;
+            return -1;
+    }
+}
+
+/**
+ * @brief Main spawn attack loop.
+ * Children are kept in a ring, oldest first, so the waitid reaping blocks
+ * on the child that should exit first.
+ */
+int spawn_attack() {
+    struct child *children;
+    struct pollfd *fds = NULL;
+    int head = 0, live = 0, i;
+    int ret = EXIT_SUCCESS;
+
+    unsigned long spawns = 0;
+    long last_report = get_current_time_us();
+    latency_hist_t hist;
+
+    children = calloc(max_children, sizeof(struct child));
+    if (children == NULL) {
+        printf("Spawn Attack: cannot allocate the children \n");
+        return EXIT_FAILURE;
+    }
+    for (i = 0; i < max_children; i++) children[i].pidfd = -1;
+
+    if (reap_mode == reap_pidfd) {
+        fds = calloc(max_children, sizeof(*fds));
+        if (fds == NULL) {
+            printf("Spawn Attack: cannot allocate the poll set \n");
+            ret = EXIT_FAILURE;
+            goto out_free;
+        }
+    }
+    if (method == spawn_clone_vm) {
+        for (i = 0; i < max_children; i++) {
+            children[i].stack = malloc(SPAWN_STACK_SIZE);
+            if (children[i].stack == NULL) {
+                printf("Spawn Attack: cannot allocate the child stacks \n");
+                ret = EXIT_FAILURE;
+                goto out_free;
+            }
+        }
+    }
+    hist_reset(&hist);
+
+    while (attack_continue(&spawn_flag)) {
+        /* Fill the pool */
+        if (live < max_children) {
+            struct child *c = &children[(head + live) % max_children];
+            uint64_t start = get_current_time_ns();
+
+            c->pid = spawn_child(c);
+            if (c->pid < 0) {
+                if (errno == EAGAIN && live > 0) goto reap;
+                printf("Spawn Attack: %s failed, errno=%d (%s)\n",
+                       spawn_method_names[method], errno, strerror(errno));
+                ret = EXIT_FAILURE;
+                break;
+            }
+            hist_record(&hist, get_current_time_ns() - start);
+
+#ifdef SYS_pidfd_open
+            if (reap_mode == reap_pidfd) {
+                c->pidfd = syscall(SYS_pidfd_open, c->pid, 0);
+            }
+#endif
+            live++;
+            spawns++;
+            continue;
+        }
+
+    reap:
+        if (reap_mode == reap_waitid || children[head].pidfd < 0) {
+            siginfo_t info;
+
+            (void)waitid(P_PID, children[head].pid, &info, WEXITED);
+            if (children[head].pidfd >= 0) close(children[head].pidfd);
+            children[head].pidfd = -1;
+            head = (head + 1) % max_children;
+            live--;
+        } else {
+            /* Reap every child that has exited, in any order */
+            for (i = 0; i < live; i++) {
+                fds[i].fd = children[(head + i) % max_children].pidfd;
+                fds[i].events = POLLIN;
+            }
+            if (poll(fds, live, -1) < 0) continue;
+
+            for (i = 0; i < live; i++) {
+                struct child *c = &children[(head + i) % max_children];
+                siginfo_t info;
+
+                if (!(fds[i].revents & POLLIN)) continue;
+                (void)waitid(P_PIDFD, c->pidfd, &info, WEXITED);
+                close(c->pidfd);
+                c->pidfd = -1;
+                c->pid = 0;
+            }
+
+            /* Compact the ring, the reaped slots become the free ones */
+            int kept = 0;
+            for (i = 0; i < live; i++) {
+                struct child *c = &children[(head + i) % max_children];
+                struct child *dst = &children[(head + kept) % max_children];
+                struct child tmp;
+
+                if (c->pid == 0) continue;
+                tmp = *dst;
+                *dst = *c;
+                *c = tmp;
+                kept++;
+            }
+            live = kept;
+        }
+
+        long now = get_current_time_us();
+        if (now - last_report >= SPAWN_REPORT_INTERVAL_US) {
+            printf("[Spawn] %.0f spawns/s with %s, %d live children\n",
+                   (double)spawns / (now - last_report) * MICROSEC,
+                   spawn_method_names[method], live);
+            hist_print(&hist, "Spawn latency");
+            add_run_hist(&run_spawn_hist, &hist);
+            hist_reset(&hist);
+            spawns = 0;
+            last_report = now;
+        }
+    }
+
+    add_run_hist(&run_spawn_hist, &hist);
+
+    /* Do not leave zombies behind */
+    for (; live > 0; live--, head = (head + 1) % max_children) {
+        siginfo_t info;
+
+        (void)waitid(P_PID, children[head].pid, &info, WEXITED);
+        if (children[head].pidfd >= 0) close(children[head].pidfd);
+        children[head].pidfd = -1;
+    }
+
+out_free:
+    for (i = 0; i < max_children; i++) {
+        if (children[i].pidfd >= 0) close(children[i].pidfd);
+        free(children[i].stack);
+    }
+    free(fds);
+    free(children);
+    return ret;
+}
+
+/**
+ * @brief Print the children spawned since the start, and their latency
+ */
+void spawn_attack_stats(double secs) {
+    pthread_mutex_lock(&run_lock);
+    printf("[Spawn] total over %.1f s: %lu spawns (%.0f/s) with %s\n", secs,
+           run_spawn_hist.count, secs > 0 ? run_spawn_hist.count / secs : 0,
+           spawn_method_names[method]);
+    hist_print(&run_spawn_hist, "Spawn latency, total");
+    pthread_mutex_unlock(&run_lock);
+}
+
+/*************************************
+ * Thread churn attack
+ * Creates and joins short-lived threads in batches. This hammers clone,
+ * TLS setup, the mmap lock (thread stacks) and the load balancer without
+ * creating new address spaces, at a much higher rate than process churn.
+ * glibc caches the stacks of exited threads; varying the stack and guard
+ * sizes defeats that cache, so every thread maps a fresh stack.
+ * ***********************************
+ */
+
+#define THREAD_MAX_BATCH 256
+
+/* The mode parameter */
+#define THREAD_VARY_STACK 0x1  // Random stack and guard sizes per thread
+
+/* Global variables */
+static int thread_batch;
+static size_t thread_stack_size;
+static size_t thread_guard_size;
+static int thread_mode;
+
+/**
+ * @brief Body of the short-lived threads
+ */
+static void *thread_main(void *arg) { return arg; }
+
+/**
+ * @brief Initialize thread churn attack channels
+ * @param:
+ * 0: number of threads created before they are joined
+ * 1: stack size, in kB (0: default)
+ * 2: guard size, in pages (0: default)
+ * 3: mode, 1 to draw a random stack size and guard size for every thread,
+ *    up to the given values
+ */
+int init_thread_churn_attack(void *arguments) {
+    int *args = (int *)arguments;
+
+    thread_batch = args[0];
+    thread_stack_size = (size_t)args[1] * KB;
+    thread_guard_size = (size_t)args[2] * PAGE_SIZE;
+    thread_mode = args[3];
+
+    if (thread_batch <= 0 || thread_batch > THREAD_MAX_BATCH ||
+        args[1] < 0 || args[2] < 0) {
+        printf("Thread churn Attack: batch must be within [1, %d] \n",
+               THREAD_MAX_BATCH);
+        return EXIT_FAILURE;
+    }
+
+    if (thread_stack_size && thread_stack_size < PTHREAD_STACK_MIN) {
+        printf("Thread churn Attack: stack must be at least %d kB \n",
+               (int)(PTHREAD_STACK_MIN / KB));
+        return EXIT_FAILURE;
+    }
+
+    /* Variation needs an upper bound */
+    if (thread_mode & THREAD_VARY_STACK) {
+        if (!thread_stack_size) thread_stack_size = 8 * 1024 * KB;
+        if (!thread_guard_size) thread_guard_size = 16 * PAGE_SIZE;
+    }
+
+    hist_reset(&run_thread_hist);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Main thread churn attack loop.
+ */
+int thread_churn_attack() {
+    pthread_t threads[THREAD_MAX_BATCH];
+    pthread_attr_t attr;
+    unsigned int seed = (unsigned int)get_current_time_us();
+    int ret = EXIT_SUCCESS, i, created;
+
+    unsigned long spawns = 0;
+    long last_report = get_current_time_us();
+    latency_hist_t hist;
+
+    hist_reset(&hist);
+
+    while (attack_continue(&thread_churn_flag)) {
+        for (created = 0; created < thread_batch; created++) {
+            uint64_t start;
+            int err;
+
+            pthread_attr_init(&attr);
+            if (thread_mode & THREAD_VARY_STACK) {
+                size_t range = thread_stack_size - PTHREAD_STACK_MIN;
+                size_t stack = PTHREAD_STACK_MIN +
+                               (range ? rand_r(&seed) % range : 0);
+                size_t guard_pages = thread_guard_size / PAGE_SIZE + 1;
+
+                pthread_attr_setstacksize(&attr, stack & ~(PAGE_SIZE - 1));
+                pthread_attr_setguardsize(
+                    &attr, (rand_r(&seed) % guard_pages) * PAGE_SIZE);
+            } else {
+                if (thread_stack_size)
+                    pthread_attr_setstacksize(&attr, thread_stack_size);
+                if (thread_guard_size)
+                    pthread_attr_setguardsize(&attr, thread_guard_size);
+            }
+
+            start = get_current_time_ns();
+            err = pthread_create(&threads[created], &attr, thread_main, NULL);
+            pthread_attr_destroy(&attr);
+            if (err != 0) {
+                if (err == EAGAIN && created > 0) break;
+                printf("Thread churn Attack: pthread_create failed (%s)\n",
+                       strerror(err));
+                ret = EXIT_FAILURE;
+                break;
+            }
+            hist_record(&hist, get_current_time_ns() - start);
+        }
+
+        for (i = 0; i < created; i++) pthread_join(threads[i], NULL);
+        spawns += created;
+        if (ret != EXIT_SUCCESS) break;
+
+        long now = get_current_time_us();
+        if (now - last_report >= SPAWN_REPORT_INTERVAL_US) {
+            printf("[Thread churn] %.0f threads/s in batches of %d\n",
+                   (double)spawns / (now - last_report) * MICROSEC,
+                   thread_batch);
+            hist_print(&hist, "Thread create latency");
+            add_run_hist(&run_thread_hist, &hist);
+            hist_reset(&hist);
+            spawns = 0;
+            last_report = now;
+        }
+    }
+
+    add_run_hist(&run_thread_hist, &hist);
+    return ret;
+}
+
+/**
+ * @brief Print the threads created since the start, and their latency
+ */
+void thread_churn_attack_stats(double secs) {
+    pthread_mutex_lock(&run_lock);
+    printf("[Thread churn] total over %.1f s: %lu threads (%.0f/s) in "
+           "batches of %d\n",
+           secs, run_thread_hist.count,
+           secs > 0 ? run_thread_hist.count / secs : 0, thread_batch);
+    hist_print(&run_thread_hist, "Thread create latency, total");
+    pthread_mutex_unlock(&run_lock);
+}
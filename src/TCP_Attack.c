@@ -0,0 +1,375 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "Attacks.h"
+#include "Control.h"
+#include "PolyRhythm.h"
+#include "Utils.h"
+
+/* network attack */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/* MSG_ZEROCOPY is only defined by recent C libraries */
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
+/* All extern trigger flags */
+extern int tcp_flag;
+
+/*************************************
+ * Parameters for TCP attack
+ * Unlike the UDP flood, a TCP stream goes through congestion control,
+ * skb coalescing and ACK processing; connection churn additionally
+ * stresses the SYN/accept path and socket allocation.
+ * ***********************************
+ */
+
+#define TCP_ADDR "127.0.0.1"
+#define TCP_BACKLOG 1024
+#define TCP_DEFAULT_MSG_SIZE (64 * KB)
+#define TCP_REPORT_INTERVAL_US 1000000  // Print throughput once per second
+
+/* Two traffic modes */
+enum tcp_mode { tcp_stream = 0, tcp_churn };
+
+/* How the sender hands its payload to the kernel */
+enum tcp_send_method { tcp_send_copy = 0, tcp_send_zerocopy, tcp_send_splice };
+
+/* Global variables */
+static int msg_size;
+static enum tcp_mode mode;
+static enum tcp_send_method send_method;
+
+/* Bytes (stream) or connections (churn) since the start, for stats */
+static unsigned long run_count;
+
+/* One listener + one drain thread per attack thread */
+struct tcp_endpoint {
+    int listener;
+    struct sockaddr_in addr;
+    int msg_size;
+    int stopping;  // Set before the listener is shut down
+};
+
+/**
+ * @brief Initialize TCP attack channels
+ * @param:
+ * 0: message size for each send (stream) or payload per connection (churn)
+ * 1: traffic mode, 0: stream, 1: connect/accept churn
+ * 2: send method, 0: copy, 1: MSG_ZEROCOPY, 2: splice from a pipe
+ */
+int init_tcp_attack(void *arguments) {
+    int *args = (int *)arguments;
+
+    msg_size = args[0] > 0 ? args[0] : TCP_DEFAULT_MSG_SIZE;
+    mode = args[1];
+    send_method = args[2];
+
+    if (mode != tcp_stream && mode != tcp_churn) {
+        printf("TCP attack: unknown mode %d \n", mode);
+        return EXIT_FAILURE;
+    }
+
+    if (send_method > tcp_send_splice) {
+        printf("TCP attack: unknown send method %d \n", send_method);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Drain everything sent to the listener.
+ * MSG_TRUNC makes TCP discard the data without copying it to user space.
+ */
+static void *tcp_drain_thread(void *arg) {
+    struct tcp_endpoint *ep = arg;
+    char *buffer = malloc(ep->msg_size);
+
+    while (!__atomic_load_n(&ep->stopping, __ATOMIC_ACQUIRE)) {
+        int conn = accept(ep->listener, NULL, NULL);
+        if (conn < 0) {
+            if (__atomic_load_n(&ep->stopping, __ATOMIC_ACQUIRE)) break;
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            printf("TCP attack accept error, errno=%d (%s)\n", errno,
+                   strerror(errno));
+            break;
+        }
+
+        while (recv(conn, buffer, ep->msg_size, MSG_TRUNC) > 0) {
+        }
+        close(conn);
+    }
+
+    free(buffer);
+    return NULL;
+}
+
+/**
+ * @brief Open a listening socket on an ephemeral loopback port
+ */
+static int tcp_open_listener(struct tcp_endpoint *ep) {
+    socklen_t len = sizeof(ep->addr);
+    int one = 1;
+
+    ep->listener = socket(AF_INET, SOCK_STREAM, 0);
+    if (ep->listener < 0) {
+        printf("TCP attack: listener socket failed, errno=%d (%s)\n", errno,
+               strerror(errno));
+        return EXIT_FAILURE;
+    }
+    setsockopt(ep->listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    memset(&ep->addr, 0, sizeof(ep->addr));
+    ep->addr.sin_family = AF_INET;
+    inet_aton(TCP_ADDR, &ep->addr.sin_addr);
+    ep->addr.sin_port = 0;  // Let the kernel pick the port
+
+    if (bind(ep->listener, (struct sockaddr *)&ep->addr, sizeof(ep->addr)) ||
+        getsockname(ep->listener, (struct sockaddr *)&ep->addr, &len) ||
+        listen(ep->listener, TCP_BACKLOG)) {
+        printf("TCP attack: listener setup failed, errno=%d (%s)\n", errno,
+               strerror(errno));
+        close(ep->listener);
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Connect a client socket to the listener
+ */
+static int tcp_connect(struct tcp_endpoint *ep) {
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s < 0) return -1;
+
+    if (connect(s, (struct sockaddr *)&ep->addr, sizeof(ep->addr))) {
+        close(s);
+        return -1;
+    }
+    return s;
+}
+
+/**
+ * @brief Reap MSG_ZEROCOPY completion notifications.
+ * They are queued on the socket error queue and must be consumed,
+ * otherwise the socket runs out of option memory and send() fails.
+ */
+static void tcp_reap_zerocopy(int s) {
+    char control[128];
+    struct msghdr msg;
+
+    for (;;) {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if (recvmsg(s, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) break;
+    }
+}
+
+/**
+ * @brief Print the achieved rate once per report interval
+ */
+static void tcp_report(unsigned long *count, long *last_report) {
+    long now = get_current_time_us();
+    long elapsed = now - *last_report;
+
+    if (elapsed < TCP_REPORT_INTERVAL_US) return;
+
+    if (mode == tcp_stream) {
+        printf("[TCP] stream: %.2f MB/s \n",
+               (double)*count / elapsed * MICROSEC / (KB * KB));
+    } else {
+        printf("[TCP] churn: %.0f connections/s \n",
+               (double)*count / elapsed * MICROSEC);
+    }
+    __atomic_fetch_add(&run_count, *count, __ATOMIC_RELAXED);
+    *count = 0;
+    *last_report = now;
+}
+
+/**
+ * @brief Stream mode: push as many bytes as possible through one connection
+ */
+static int tcp_stream_loop(struct tcp_endpoint *ep, char *payload) {
+    enum tcp_send_method method = send_method;  // Falls back per thread
+    unsigned long bytes = 0;
+    long last_report = get_current_time_us();
+    int pipefd[2] = {-1, -1};
+    int one = 1;
+    int s;
+
+    s = tcp_connect(ep);
+    if (s < 0) {
+        printf("TCP attack: connect failed, errno=%d (%s)\n", errno,
+               strerror(errno));
+        return EXIT_FAILURE;
+    }
+
+    if (method == tcp_send_zerocopy &&
+        setsockopt(s, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one))) {
+        printf("TCP attack: SO_ZEROCOPY unsupported, falling back to copy \n");
+        method = tcp_send_copy;
+    }
+
+    if (method == tcp_send_splice) {
+        if (pipe(pipefd)) {
+            printf("TCP attack: pipe failed, errno=%d (%s)\n", errno,
+                   strerror(errno));
+            close(s);
+            return EXIT_FAILURE;
+        }
+        /* Best effort, the pipe must hold one whole message */
+        (void)fcntl(pipefd[1], F_SETPIPE_SZ, msg_size);
+    }
+
+    while (attack_continue(&tcp_flag)) {
+        ssize_t ret;
+
+        if (method == tcp_send_copy) {
+            ret = send(s, payload, msg_size, 0);
+        } else if (method == tcp_send_zerocopy) {
+            ret = send(s, payload, msg_size, MSG_ZEROCOPY);
+            tcp_reap_zerocopy(s);
+            if (ret < 0 && errno == ENOBUFS) continue;
+        } else {
+            /* Map the payload pages into the pipe, then move them to the
+             * socket without copying through user space */
+            struct iovec iov = {.iov_base = payload, .iov_len = msg_size};
+            ret = vmsplice(pipefd[1], &iov, 1, 0);
+            while (ret > 0) {
+                ssize_t moved = splice(pipefd[0], NULL, s, NULL, ret,
+                                       SPLICE_F_MOVE | SPLICE_F_MORE);
+                if (moved <= 0) {
+                    ret = moved;
+                    break;
+                }
+                ret -= moved;
+                bytes += moved;
+            }
+        }
+
+        if (ret < 0) {
+            if (errno == EINTR) continue;
+            printf("TCP attack send error, errno=%d (%s)\n", errno,
+                   strerror(errno));
+            break;
+        }
+        if (method != tcp_send_splice) bytes += ret;
+
+        tcp_report(&bytes, &last_report);
+    }
+
+    __atomic_fetch_add(&run_count, bytes, __ATOMIC_RELAXED);
+    if (pipefd[0] >= 0) {
+        close(pipefd[0]);
+        close(pipefd[1]);
+    }
+    close(s);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Churn mode: connect, send one message, abort the connection.
+ * SO_LINGER with a zero timeout resets the connection instead of
+ * leaving it in TIME_WAIT, so ephemeral ports are never exhausted.
+ */
+static int tcp_churn_loop(struct tcp_endpoint *ep, char *payload) {
+    unsigned long connections = 0;
+    long last_report = get_current_time_us();
+    struct linger abort_close = {.l_onoff = 1, .l_linger = 0};
+
+    while (attack_continue(&tcp_flag)) {
+        int s = tcp_connect(ep);
+        if (s < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            printf("TCP attack: connect failed, errno=%d (%s)\n", errno,
+                   strerror(errno));
+            return EXIT_FAILURE;
+        }
+
+        (void)send(s, payload, msg_size, MSG_NOSIGNAL);
+        setsockopt(s, SOL_SOCKET, SO_LINGER, &abort_close,
+                   sizeof(abort_close));
+        close(s);
+
+        connections++;
+        tcp_report(&connections, &last_report);
+    }
+
+    __atomic_fetch_add(&run_count, connections, __ATOMIC_RELAXED);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Main TCP attack loop.
+ */
+int tcp_attack() {
+    struct tcp_endpoint ep;
+    pthread_t drain;
+    char *payload;
+    int ret;
+
+    if (tcp_open_listener(&ep) != EXIT_SUCCESS) return EXIT_FAILURE;
+    ep.msg_size = msg_size;
+    ep.stopping = 0;
+
+    /* Page-aligned payload so vmsplice and MSG_ZEROCOPY pin whole pages */
+    if (posix_memalign((void **)&payload, PAGE_SIZE, msg_size)) {
+        printf("TCP attack: failed to allocate payload \n");
+        close(ep.listener);
+        return EXIT_FAILURE;
+    }
+    rand_str(payload, msg_size - 1);
+
+    if (pthread_create(&drain, NULL, tcp_drain_thread, &ep)) {
+        printf("TCP attack: failed to create drain thread \n");
+        free(payload);
+        close(ep.listener);
+        return EXIT_FAILURE;
+    }
+
+    if (mode == tcp_stream) {
+        ret = tcp_stream_loop(&ep, payload);
+    } else {
+        ret = tcp_churn_loop(&ep, payload);
+    }
+
+    /* Unblock accept(), tcp_flag is still set on a switch */
+    __atomic_store_n(&ep.stopping, 1, __ATOMIC_RELEASE);
+    shutdown(ep.listener, SHUT_RDWR);
+    pthread_join(drain, NULL);
+    close(ep.listener);
+    free(payload);
+
+    return ret;
+}
+
+/**
+ * @brief Print the bytes streamed or the connections churned since the
+ * start
+ */
+void tcp_attack_stats(double secs) {
+    double per_sec = secs > 0 ? 1 / secs : 0;
+
+    if (mode == tcp_stream) {
+        printf("[TCP] stream total over %.1f s: %.1f MB (%.2f MB/s) \n", secs,
+               (double)run_count / (KB * KB), run_count * per_sec / (KB * KB));
+    } else {
+        printf("[TCP] churn total over %.1f s: %lu connections (%.0f/s) \n",
+               secs, run_count, run_count * per_sec);
+    }
+}
@@ -3,6 +3,7 @@
 #include <time.h>
 
 #include "Attacks.h"
+#include "Control.h"
 #include "PolyRhythm.h"
 #include "Utils.h"
 
@@ -14,7 +15,6 @@
 
 /* All extern trigger flags */
 extern int tlb_flag;
-extern struct action *shared_memory_action;
 
 /* feedbacks for RL, defined in PolyRhythm_RL.c */
 
@@ -51,14 +51,14 @@ int tlb_attack() {
 #ifdef RL_ONLINE
 
 #ifdef TIMER
-    while (shared_memory_action->tlb) {
+    while (attack_continue(&tlb_flag)) {
 #else
     for (int it = 0; it < TLB_ITERATIONS; it++) {
 #endif
 
 #else
     /* For normal mode of PolyRhythm */
-    while (tlb_flag) {
+    while (attack_continue(&tlb_flag)) {
 #endif
 
         uint8_t *mem, *ptr;
@@ -86,7 +86,10 @@ int tlb_attack() {
 
         char buffer[PAGE_SIZE];  // data trampoline
 
-        for (ptr = mem; ptr < mem + mmap_size; ptr += PAGE_SIZE) {
+        /* Three syscalls per page, so check for a stop or switch on every
+         * page; the munmap below releases the pages left */
+        for (ptr = mem; ptr < mem + mmap_size && attack_continue(&tlb_flag);
+             ptr += PAGE_SIZE) {
             /* Force tlb shoot down on page */
             (void)mprotect(ptr, PAGE_SIZE, PROT_READ);
             (void)memcpy(buffer, ptr, PAGE_SIZE);
@@ -0,0 +1,204 @@
+#include "Trigger.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/prctl.h>
+#include <sys/shm.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Control.h"
+#include "Utils.h"
+
+enum trigger_source {
+    trigger_none = 0,
+    trigger_shm,
+    trigger_futex,
+    trigger_pipe,
+    trigger_proc,
+};
+
+static enum trigger_source source;
+static char source_name[128];
+static uint32_t *counter;  // shm and futex sources
+static int source_fd = -1; // pipe and proc sources
+static uint64_t min_spacing;
+
+/* Latest release, written by the watcher only */
+static uint32_t release_seq;
+static uint64_t release_time;
+
+/**
+ * @brief Parse the source, and open it so that errors show at startup
+ * @spec: shm:<key>, futex:<key>, pipe:<path> or proc:<pid>
+ */
+int trigger_parse(const char *spec) {
+    const char *value = strchr(spec, ':');
+    char path[64];
+
+    if (value == NULL || value[1] == '\0') goto invalid;
+    value++;
+    snprintf(source_name, sizeof(source_name), "%s", spec);
+
+    if (strncmp(spec, "shm:", 4) == 0 || strncmp(spec, "futex:", 6) == 0) {
+        key_t key = (key_t)strtol(value, NULL, 0);
+        int id = shmget(key, sizeof(uint32_t), IPC_CREAT | 0666);
+
+        if (id < 0 || (counter = shmat(id, NULL, 0)) == (void *)-1) {
+            printf("Trigger: cannot attach shared memory %s: %s \n", value,
+                   strerror(errno));
+            return EXIT_FAILURE;
+        }
+        source = spec[0] == 's' ? trigger_shm : trigger_futex;
+    } else if (strncmp(spec, "pipe:", 5) == 0) {
+        /* Read-write, so the FIFO never reports EOF between two writers */
+        source_fd = open(value, O_RDWR);
+        if (source_fd < 0) {
+            printf("Trigger: cannot open %s: %s \n", value, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        source = trigger_pipe;
+    } else if (strncmp(spec, "proc:", 5) == 0) {
+        snprintf(path, sizeof(path), "/proc/%d/stat", atoi(value));
+        source_fd = open(path, O_RDONLY);
+        if (source_fd < 0) {
+            printf("Trigger: cannot open %s: %s \n", path, strerror(errno));
+            return EXIT_FAILURE;
+        }
+        source = trigger_proc;
+    } else {
+        goto invalid;
+    }
+    return EXIT_SUCCESS;
+
+invalid:
+    printf("Trigger: expected shm:<key>, futex:<key>, pipe:<path> or "
+           "proc:<pid>, got %s \n",
+           spec);
+    return EXIT_FAILURE;
+}
+
+int trigger_enabled(void) { return source != trigger_none; }
+
+const char *trigger_name(void) { return source_name; }
+
+uint32_t trigger_last(uint64_t *release_ns) {
+    uint32_t seq;
+
+    /* The watcher writes the time first; retry if a release came between */
+    do {
+        seq = __atomic_load_n(&release_seq, __ATOMIC_ACQUIRE);
+        *release_ns = __atomic_load_n(&release_time, __ATOMIC_ACQUIRE);
+    } while (__atomic_load_n(&release_seq, __ATOMIC_ACQUIRE) != seq);
+    return seq;
+}
+
+/**
+ * @brief Publish a release and wake the parked attack threads
+ */
+static void release(uint64_t now) {
+    int i;
+
+    if (release_seq && now - release_time < min_spacing) return;
+
+    __atomic_store_n(&release_time, now, __ATOMIC_RELEASE);
+    __atomic_store_n(&release_seq, release_seq + 1, __ATOMIC_RELEASE);
+    for (i = 0; i < ctl_count(); i++) {
+        attack_ctl_t *ctl = ctl_at(i);
+
+        if (__atomic_load_n(&ctl->active, __ATOMIC_ACQUIRE)) ctl_kick(ctl);
+    }
+}
+
+/**
+ * @brief Scheduling state of the victim, from /proc/<pid>/stat
+ * @return the state letter, 0 once the victim is gone
+ */
+static char proc_state(void) {
+    char buf[512], *p;
+    ssize_t n = pread(source_fd, buf, sizeof(buf) - 1, 0);
+
+    if (n <= 0) return 0;
+    buf[n] = '\0';
+
+    /* The command name may hold spaces and parentheses */
+    p = strrchr(buf, ')');
+    return p != NULL && p[1] == ' ' ? p[2] : 0;
+}
+
+static void *watch_releases(void *arg) {
+    struct timespec poll = {.tv_sec = 0, .tv_nsec = TRIGGER_POLL_NS};
+    uint32_t last = counter ? __atomic_load_n(counter, __ATOMIC_ACQUIRE) : 0;
+    char buf[64], state = 0, previous = 0;
+
+    (void)prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+
+    while (!ctl_stopping()) {
+        uint32_t value;
+
+        switch (source) {
+            case trigger_shm:
+                value = __atomic_load_n(counter, __ATOMIC_ACQUIRE);
+                if (value != last) release(get_current_time_ns());
+                last = value;
+                nanosleep(&poll, NULL);
+                break;
+
+            case trigger_futex: {
+                /* Bounded wait, to notice a stop */
+                struct timespec timeout = {.tv_sec = 0, .tv_nsec = 100000000};
+
+                value = __atomic_load_n(counter, __ATOMIC_ACQUIRE);
+                if (value == last) {
+                    syscall(SYS_futex, counter, FUTEX_WAIT, last, &timeout,
+                            NULL, 0);
+                    value = __atomic_load_n(counter, __ATOMIC_ACQUIRE);
+                }
+                if (value != last) release(get_current_time_ns());
+                last = value;
+                break;
+            }
+
+            case trigger_pipe:
+                if (read(source_fd, buf, sizeof(buf)) > 0)
+                    release(get_current_time_ns());
+                break;
+
+            case trigger_proc:
+                state = proc_state();
+                if (state == 0) {
+                    printf("Trigger: %s is gone \n", source_name);
+                    return NULL;
+                }
+                if (state == 'R' && previous != 'R')
+                    release(get_current_time_ns());
+                previous = state;
+                nanosleep(&poll, NULL);
+                break;
+
+            default:
+                return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+int trigger_start(uint64_t min_spacing_ns) {
+    pthread_t watcher;
+
+    min_spacing = min_spacing_ns;
+    if (pthread_create(&watcher, NULL, watch_releases, NULL) != 0) {
+        printf("Trigger: cannot start the release watcher \n");
+        return EXIT_FAILURE;
+    }
+    pthread_detach(watcher);
+    return EXIT_SUCCESS;
+}
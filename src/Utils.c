@@ -1,23 +1,57 @@
 #include "Utils.h"
 
+#include "Burst.h"
+#include "Perf.h"
+#include "Registry.h"
+#include "Shm.h"
+#include "Trigger.h"
+
 /**
  *  @brief Parse the command line
  *  The options format is L
- *  ./polyrythm attack_channel  num_threads para1 para2 para3 para4 online_flag
+ *  ./polyrythm [-b burst] [-t trigger] [-m counters] [-i instance] attack_channel  num_threads para1 para2 para3 para4 online_flag
  *  e.g. :
  *  ./polyrythm cache           2           1     835   0     0     0
+ *  The primitives are looked up in the registry. -b on,period[,phase[,jitter]]
+ *  (in us) runs all attack threads in bursts, see include/Burst.h, and
+ *  -t <source> starts the bursts on victim releases, see include/Trigger.h.
+ *  -m <scope> samples hardware counters, see include/Perf.h. -i <name>
+ *  names the shared memory segments of this instance, see include/Shm.h.
  */
-int parse_options(int argc, char *argv[],
-                  attack_channel_info_t attack_channels[]) {
-    int optind;
+int parse_options(int argc, char *argv[]) {
+    int optind, first = 1;
     char *tmp_str_end;
 
+    while (first + 1 < argc && argv[first][0] == '-') {
+        if (strcmp(argv[first], "-b") == 0) {
+            if (burst_parse(argv[first + 1]) != EXIT_SUCCESS)
+                return EXIT_FAILURE;
+        } else if (strcmp(argv[first], "-t") == 0) {
+            if (trigger_parse(argv[first + 1]) != EXIT_SUCCESS)
+                return EXIT_FAILURE;
+        } else if (strcmp(argv[first], "-m") == 0) {
+            if (perf_parse(argv[first + 1]) != EXIT_SUCCESS)
+                return EXIT_FAILURE;
+        } else if (strcmp(argv[first], "-i") == 0) {
+            if (shm_set_instance(argv[first + 1]) != EXIT_SUCCESS)
+                return EXIT_FAILURE;
+        } else {
+            printf("Unknown option %s \n", argv[first]);
+            return EXIT_FAILURE;
+        }
+        first += 2;
+    }
+    if (burst_check_trigger() != EXIT_SUCCESS) return EXIT_FAILURE;
+
     const int NUM_ARGS = (NUM_PARAMS + 3); //Each channel has 3 arguments (attack_channel num_threads online_flag) + params
-    if ((argc - 1) % NUM_ARGS != 0)
+    if ((argc - first) % NUM_ARGS != 0)
     {
         printf("Parameters errors ! Please follow the pattern: \n");
         printf(
-            "./polyrhythm <channel> <num_thread> <para1> <para2> <para3>"
+            "./polyrhythm [-b <on_us>,<period_us>[,<phase_us>[,<jitter_us>]]]"
+            "             [-t shm:<key>|futex:<key>|pipe:<path>|proc:<pid>]"
+            "             [-m all|pid:<pid>|self[,<period_us>]] [-i <instance>]"
+            "             <channel> <num_thread> <para1> <para2> <para3>"
             "             <para4> <online_flag> \n"
         );
         return EXIT_FAILURE;
@@ -25,75 +59,37 @@ int parse_options(int argc, char *argv[],
 
     /* We did not use getopt because we target not only Linux system in the
      * beginning of this project */
-    // while ((opt = getopt(argc, argv, "xxxx")) != -1) {
-
-    for (optind = 1; optind < argc; optind += 3 + NUM_PARAMS) {
+    for (optind = first; optind < argc; optind += 3 + NUM_PARAMS) {
         int num_threads = strtol(argv[optind + 1], &tmp_str_end, 10);
+        primitive_ctx_t *ctx = find_primitive(argv[optind]);
 
-        // printf("Hello the channel: %s, the number of threads: %d \n",
-        // argv[optind], num_threads);
-
-        /* Iterate through channels */
-        int i = 0;
-        attack_channel_info_t *iter = &attack_channels[0];
-        while (iter->name != NULL) {
-            if (strcmp(argv[optind], iter->name) == 0) {
-                iter->num_threads = num_threads;
-                for (int j = 0; j < NUM_PARAMS + 1; j++) {
-                    /* Store parameters */
-                    iter->attack_paras[j] =
-                        strtol(argv[optind + j + 2], &tmp_str_end, 10);
-                }
-                break;
-            }
-            i++;
-
-            iter = &attack_channels[i];
-        }
-
-        /*
-        printf ("%d\n", sizeof(*attack_channels));
-        printf ("%d\n", sizeof(attack_channel_info_t));
-        for(i = 0; i < sizeof(*attack_channels) / sizeof(attack_channel_info_t);
-        i++) { printf ("%d", i); if (strcmp(argv[optind],
-        attack_channels[i].name)  == 0) { attack_channels[i].num_threads =
-        num_threads;
-            }
+        if (ctx == NULL) {
+            printf("Unknown attack channel %s \n", argv[optind]);
+            return EXIT_FAILURE;
         }
 
-*/
-
-        /*
-        if (strcmp(argv[optind], "cache") == 0) {
-            printf("cache~ \n");
-        } else if (strcmp(argv[optind], "memory")  == 0) {
-            printf("memory~ \n");
-        } else if (strcmp(argv[optind], "tlb")  == 0) {
-            printf("tlb~ \n");
-        } else if (strcmp(argv[optind], "network")  == 0) {
-            printf("network~ \n");
-        } else if (strcmp(argv[optind], "disk_io")  == 0) {
-            printf("disk io~ \n");
+        ctx->num_threads = num_threads;
+        for (int j = 0; j < NUM_PARAMS + 1; j++) {
+            /* Store parameters */
+            ctx->params[j] = strtol(argv[optind + j + 2], &tmp_str_end, 10);
         }
-*/
     }
     return EXIT_SUCCESS;
 }
 
 /**
  * @brief Print the parsed options
- * @attack_channels:parameters of different channels
  */
-int print_options(attack_channel_info_t attack_channels[]) {
-    int i = 0;
-    attack_channel_info_t *iter = &attack_channels[0];
-    while (iter->name != NULL) {
-        if (iter->num_threads != 0) {
-            printf("Attack channel : %s, number of threads: %d \n", iter->name,
-                   iter->num_threads);
+int print_options(void) {
+    int i;
+
+    for (i = 0; i < num_primitives(); i++) {
+        primitive_ctx_t *ctx = primitive_at(i);
+
+        if (ctx->num_threads != 0) {
+            printf("Attack channel : %s, number of threads: %d \n",
+                   ctx->desc.name, ctx->num_threads);
         }
-        i++;
-        iter = &attack_channels[i];
     }
     return EXIT_SUCCESS;
 }
@@ -220,6 +216,17 @@ long get_current_time_us(void) {
     return spec.tv_sec * MICROSEC + spec.tv_nsec / 1000;
 }
 
+/**
+ @brief: Get the current monotonic time in nanoseconds,
+ for measuring latencies that must not jump with wall-clock adjustments
+ @return: Current time
+ */
+uint64_t get_current_time_ns(void) {
+    struct timespec spec;
+    clock_gettime(CLOCK_MONOTONIC, &spec);
+    return (uint64_t)spec.tv_sec * NANOSEC + spec.tv_nsec;
+}
+
 /**
  @brief: print the resource usage
  @return: 0 on success
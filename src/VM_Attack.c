@@ -0,0 +1,308 @@
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Attacks.h"
+#include "Control.h"
+#include "PolyRhythm.h"
+#include "Utils.h"
+
+/* Extern trigger flags
+ * To stop attack primitives
+ */
+extern int vm_flag;
+
+/*************************************
+ * Virtual memory attack
+ * Keeps the memory management of the kernel busy, in one of these modes:
+ *  - minor-fault storm: touch a region, then drop it with MADV_DONTNEED,
+ *    so every touch allocates and zeroes a page, and every drop flushes
+ *    the TLBs of the CPUs running our threads
+ *  - COW-fault storm: fork, and have the child write into the region the
+ *    parent filled, so every write copies a page
+ *  - THP pressure: fault the region in with transparent huge pages
+ *    (compaction when memory is fragmented), then split every huge page
+ *    by dropping one of its small pages
+ *  - RSS balloon: grow the region and keep it hot, pushing the rest of
+ *    the machine (the victim) toward reclaim; it can also breathe, to
+ *    make the kernel refault what it reclaimed
+ * The activity of the whole machine is read from /proc/vmstat.
+ * ***********************************
+ */
+
+#define VM_HUGE_PAGE_SIZE (2 * MB)
+#define VM_MAX_LINE 256
+#define VM_REPORT_INTERVAL_US 1000000  // Print rates once per second
+
+enum vm_mode {
+    vm_minor_faults = 0,
+    vm_cow_faults,
+    vm_thp_split,
+    vm_balloon,
+    vm_num_modes
+};
+
+static const char *vm_mode_names[vm_num_modes] = {"minor faults", "COW faults",
+                                                  "THP split", "balloon"};
+
+/* Counters reported from /proc/vmstat, summed by prefix */
+static const char *vmstat_labels[] = {
+    "pgfault",       "pgmajfault",    "thp_fault_alloc", "thp_split_pmd",
+    "compact_stall", "pgscan_kswapd", "pgscan_direct",   "pgsteal_",
+    "pswpout"};
+#define NUM_VMSTAT_LABELS (sizeof(vmstat_labels) / sizeof(vmstat_labels[0]))
+
+/* Global variables */
+static int vm_mode;
+static size_t region_size;
+static size_t stride;         // Bytes between two touched bytes
+static long hold_us;          // Pause between rounds, or balloon hold time
+
+static int next_thread_index;
+
+/**
+ * @brief Read the counters of vmstat_labels from /proc/vmstat
+ */
+static int read_vmstat(unsigned long long *counts) {
+    char line[VM_MAX_LINE], name[VM_MAX_LINE];
+    unsigned long long value;
+    unsigned int i;
+    FILE *f = fopen("/proc/vmstat", "r");
+
+    if (f == NULL) return EXIT_FAILURE;
+    memset(counts, 0, sizeof(*counts) * NUM_VMSTAT_LABELS);
+
+    while (fgets(line, sizeof(line), f) != NULL) {
+        if (sscanf(line, "%255s %llu", name, &value) != 2) continue;
+        for (i = 0; i < NUM_VMSTAT_LABELS; i++) {
+            size_t len = strlen(vmstat_labels[i]);
+
+            /* A trailing '_' sums all the counters with that prefix */
+            if (strncmp(name, vmstat_labels[i], len) == 0 &&
+                (name[len] == '\0' || vmstat_labels[i][len - 1] == '_'))
+                counts[i] += value;
+        }
+    }
+
+    fclose(f);
+    return EXIT_SUCCESS;
+}
+
+/* Counters when the first attack thread started, for stats */
+static unsigned long long start_counts[NUM_VMSTAT_LABELS];
+static uint64_t start_ns;
+
+/**
+ * @brief Print the vmstat rates between two samples
+ */
+static void print_vm_rates(const unsigned long long *counts,
+                           const unsigned long long *last, double secs) {
+    unsigned int i;
+
+    for (i = 0; i < NUM_VMSTAT_LABELS; i++) {
+        int len = strlen(vmstat_labels[i]);
+
+        if (vmstat_labels[i][len - 1] == '_') len--;
+        printf("%.*s %.0f%s", len, vmstat_labels[i],
+               (counts[i] - last[i]) / secs,
+               i < NUM_VMSTAT_LABELS - 1 ? ", " : "\n");
+    }
+}
+
+/**
+ * @brief Print the vmstat rates since the last call
+ */
+static void report_vm_rates(long elapsed_us) {
+    static unsigned long long last[NUM_VMSTAT_LABELS];
+    static int primed;
+    unsigned long long counts[NUM_VMSTAT_LABELS];
+
+    if (read_vmstat(counts) != EXIT_SUCCESS) return;
+
+    if (primed) {
+        printf("[VM] %s, per second: ", vm_mode_names[vm_mode]);
+        print_vm_rates(counts, last, (double)elapsed_us / MICROSEC);
+    } else {
+        memcpy(start_counts, counts, sizeof(counts));
+        start_ns = get_current_time_ns();
+    }
+
+    memcpy(last, counts, sizeof(counts));
+    primed = 1;
+}
+
+/**
+ * @brief Initialize the virtual memory attack channels
+ * @param:
+ * 0: mode, 0: minor faults, 1: COW faults after fork, 2: THP split,
+ *    3: RSS balloon
+ * 1: region size per attack thread, in MB
+ * 2: touch stride, in pages (0 or 1: every page)
+ * 3: pause between rounds, in ms (0: none); in balloon mode, how long the
+ *    region is held before it is dropped and grown again (0: held forever)
+ */
+int init_vm_attack(void *arguments) {
+    int *args = (int *)arguments;
+
+    vm_mode = args[0];
+    if (vm_mode < 0 || vm_mode >= vm_num_modes) {
+        printf("VM Attack: unknown mode %d \n", vm_mode);
+        return EXIT_FAILURE;
+    }
+    if (args[1] <= 0 || args[3] < 0) {
+        printf("VM Attack: invalid region size %d MB or pause %d ms \n",
+               args[1], args[3]);
+        return EXIT_FAILURE;
+    }
+
+    region_size = (size_t)args[1] * MB;
+    if (vm_mode == vm_thp_split) {
+        region_size = (region_size + VM_HUGE_PAGE_SIZE - 1) &
+                      ~(size_t)(VM_HUGE_PAGE_SIZE - 1);
+    }
+    stride = (size_t)(args[2] > 1 ? args[2] : 1) * PAGE_SIZE;
+    hold_us = (long)args[3] * 1000;
+
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Write one byte in every stride of the range
+ */
+static void touch_range(volatile char *addr, size_t len) {
+    size_t off;
+
+    for (off = 0; off < len && attack_continue(&vm_flag); off += stride)
+        addr[off]++;
+}
+
+/**
+ * @brief One round of COW faults: the child dirties the region that it
+ * shares with the parent, then the parent takes its own write faults back
+ */
+static void cow_round(char *region) {
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        touch_range(region, region_size);
+        _exit(0);
+    } else if (pid > 0) {
+        waitpid(pid, NULL, 0);
+        touch_range(region, region_size);
+    }
+}
+
+/**
+ * @brief One round of THP pressure: fault in huge pages, split each of
+ * them by dropping one small page, then drop everything
+ */
+static void thp_round(char *region) {
+    size_t off;
+
+    touch_range(region, region_size);
+    for (off = 0; off < region_size && attack_continue(&vm_flag);
+         off += VM_HUGE_PAGE_SIZE) {
+        madvise(region + off + PAGE_SIZE, PAGE_SIZE, MADV_DONTNEED);
+    }
+    madvise(region, region_size, MADV_DONTNEED);
+}
+
+/**
+ * @brief Main virtual memory attack loop.
+ */
+int vm_attack() {
+    char *mapping, *region;
+    size_t map_size = region_size;
+    int index;
+    long last_report = get_current_time_us();
+    long held_since = 0;
+
+    index = __atomic_fetch_add(&next_thread_index, 1, __ATOMIC_RELAXED);
+
+    /* Huge pages need a 2MB-aligned region */
+    if (vm_mode == vm_thp_split) map_size = region_size + VM_HUGE_PAGE_SIZE;
+    mapping = mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapping == MAP_FAILED) {
+        printf("VM Attack: cannot map %zu bytes: %s \n", map_size,
+               strerror(errno));
+        return EXIT_FAILURE;
+    }
+    region = mapping;
+    if (vm_mode == vm_thp_split) {
+        region = (char *)(((uintptr_t)mapping + VM_HUGE_PAGE_SIZE - 1) &
+                          ~(uintptr_t)(VM_HUGE_PAGE_SIZE - 1));
+        if (madvise(region, region_size, MADV_HUGEPAGE) < 0) {
+            printf("VM Attack: MADV_HUGEPAGE failed: %s \n", strerror(errno));
+        }
+    } else {
+        /* Small pages only, so that every touch is one fault */
+        madvise(region, region_size, MADV_NOHUGEPAGE);
+    }
+
+    if (vm_mode == vm_cow_faults) touch_range(region, region_size);
+    if (index == 0) report_vm_rates(0);
+
+    while (attack_continue(&vm_flag)) {
+        switch (vm_mode) {
+            case vm_minor_faults:
+                touch_range(region, region_size);
+                madvise(region, region_size, MADV_DONTNEED);
+                break;
+            case vm_cow_faults:
+                cow_round(region);
+                break;
+            case vm_thp_split:
+                thp_round(region);
+                break;
+            case vm_balloon:
+                /* Keep the whole region hot, so reclaim goes elsewhere */
+                touch_range(region, region_size);
+                if (held_since == 0) held_since = get_current_time_us();
+                if (hold_us && get_current_time_us() - held_since >= hold_us) {
+                    madvise(region, region_size, MADV_DONTNEED);
+                    held_since = 0;
+                }
+                break;
+        }
+
+        if (hold_us && vm_mode != vm_balloon) {
+            struct timespec ts = {.tv_sec = hold_us / MICROSEC,
+                                  .tv_nsec = (hold_us % MICROSEC) * 1000};
+            nanosleep(&ts, NULL);
+        }
+
+        /* The first attack thread reports for all of them */
+        long now = get_current_time_us();
+        if (index == 0 && now - last_report >= VM_REPORT_INTERVAL_US) {
+            report_vm_rates(now - last_report);
+            last_report = now;
+        }
+    }
+
+    munmap(mapping, map_size);
+    return EXIT_SUCCESS;
+}
+
+/**
+ * @brief Print the average vmstat rates since the first attack thread
+ * started
+ */
+void vm_attack_stats(double secs) {
+    unsigned long long counts[NUM_VMSTAT_LABELS];
+    double wall = (double)(get_current_time_ns() - start_ns) / NANOSEC;
+
+    if (start_ns == 0 || read_vmstat(counts) != EXIT_SUCCESS) return;
+
+    printf("[VM] %s, average per second over %.1f s (%.1f s attacking): ",
+           vm_mode_names[vm_mode], wall, secs);
+    print_vm_rates(counts, start_counts, wall);
+}